@@ -0,0 +1,69 @@
+#include "stdafx.h"
+#include "BarrierBatcher.h"
+
+BarrierBatcher::BarrierBatcher() :
+	m_requestedCount(0),
+	m_emittedCount(0),
+	m_flushCount(0)
+{
+}
+
+void BarrierBatcher::Transition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter, UINT subresource, D3D12_RESOURCE_BARRIER_FLAGS flags)
+{
+	Add(CD3DX12_RESOURCE_BARRIER::Transition(pResource, stateBefore, stateAfter, subresource, flags));
+}
+
+void BarrierBatcher::Add(const D3D12_RESOURCE_BARRIER& barrier)
+{
+	m_requestedCount++;
+
+	// split barriers have to stay as they are, their begin and end halves are matched by the driver
+	if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION || barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE)
+	{
+		m_pendingBarriers.push_back(barrier);
+		return;
+	}
+
+	// look for the latest queued barrier that touches the same resource
+	const D3D12_RESOURCE_TRANSITION_BARRIER& transition = barrier.Transition;
+	for (size_t i = m_pendingBarriers.size(); i > 0; i--)
+	{
+		D3D12_RESOURCE_BARRIER& pending = m_pendingBarriers[i - 1];
+		if (pending.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+		{
+			break; // don't move anything across a uav or aliasing barrier
+		}
+		if (pending.Transition.pResource != transition.pResource)
+		{
+			continue;
+		}
+		if (pending.Transition.Subresource != transition.Subresource || pending.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE
+			|| pending.Transition.StateAfter != transition.StateBefore)
+		{
+			break; // only fold transitions that chain up exactly
+		}
+
+		// A->B and B->C become A->C, and nothing at all when C is A
+		pending.Transition.StateAfter = transition.StateAfter;
+		if (pending.Transition.StateBefore == pending.Transition.StateAfter)
+		{
+			m_pendingBarriers.erase(m_pendingBarriers.begin() + (i - 1));
+		}
+		return;
+	}
+
+	m_pendingBarriers.push_back(barrier);
+}
+
+void BarrierBatcher::Flush(ID3D12GraphicsCommandList* pCommandList)
+{
+	if (m_pendingBarriers.empty())
+	{
+		return;
+	}
+
+	pCommandList->ResourceBarrier(static_cast<UINT>(m_pendingBarriers.size()), m_pendingBarriers.data());
+	m_emittedCount += m_pendingBarriers.size();
+	m_flushCount++;
+	m_pendingBarriers.clear();
+}
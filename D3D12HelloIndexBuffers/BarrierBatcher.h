@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "DXSampleHelper.h"
+
+// Collects resource barriers and records them with a single ResourceBarrier() call.
+// Call Flush() right before the next draw, dispatch, copy or clear that depends on the
+// queued transitions, and before closing the command list.
+//
+// While the barriers are queued, transitions of the same subresource are folded
+// together: A->B followed by B->C becomes A->C, and A->B followed by B->A disappears.
+// Barriers are never folded across a UAV or aliasing barrier, or across a transition
+// of the same resource that covers a different set of subresources.
+//
+// A batcher is meant to be used by one thread recording one command list at a time.
+class BarrierBatcher
+{
+public:
+	BarrierBatcher();
+
+	// Queues a transition of one subresource, or of all of them.
+	void Transition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter,
+		UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE);
+
+	// Queues any barrier, transitions go through the same folding as Transition().
+	void Add(const D3D12_RESOURCE_BARRIER& barrier);
+
+	// Records the queued barriers, if there are any, and empties the queue.
+	void Flush(ID3D12GraphicsCommandList* pCommandList);
+
+	bool IsEmpty() const { return m_pendingBarriers.empty(); }
+
+	UINT64 GetRequestedCount() const { return m_requestedCount; } // barriers queued by the caller
+	UINT64 GetEmittedCount() const { return m_emittedCount; } // barriers that actually reached a command list
+	UINT64 GetFlushCount() const { return m_flushCount; } // ResourceBarrier() calls made
+
+private:
+	std::vector<D3D12_RESOURCE_BARRIER> m_pendingBarriers;
+	UINT64 m_requestedCount;
+	UINT64 m_emittedCount;
+	UINT64 m_flushCount;
+};
@@ -0,0 +1,68 @@
+#include "stdafx.h"
+#include "CommandAllocatorPool.h"
+
+CommandAllocatorPool::CommandAllocatorPool(ID3D12Device* pDevice, UINT64 maxRetainedCommandCount) :
+	m_device(pDevice),
+	m_maxRetainedCommandCount(maxRetainedCommandCount),
+	m_createdCount(0),
+	m_discardedCount(0),
+	m_highWaterMark(0)
+{
+}
+
+ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::Acquire(D3D12_COMMAND_LIST_TYPE type, UINT64 completedFenceValue)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// allocators are released in fence order, so only the front of the queue can be retired
+	std::deque<RetiredAllocator>& retiredAllocators = m_retiredAllocators[type];
+	while (!retiredAllocators.empty() && retiredAllocators.front().fenceValue <= completedFenceValue)
+	{
+		RetiredAllocator retired = retiredAllocators.front();
+		retiredAllocators.pop_front();
+
+		// the gpu is done with it, so an allocator that grew too large can simply be let go
+		if (retired.highWaterMark > m_maxRetainedCommandCount)
+		{
+			m_discardedCount++;
+			continue;
+		}
+
+		ThrowIfFailed(retired.allocator->Reset());
+		m_highWaterMarks[retired.allocator.Get()] = retired.highWaterMark;
+		return retired.allocator;
+	}
+
+	ComPtr<ID3D12CommandAllocator> allocator = CreateAllocator(type);
+	m_createdCount++;
+	m_highWaterMarks[allocator.Get()] = 0;
+	return allocator;
+}
+
+void CommandAllocatorPool::Release(D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator* pAllocator, UINT64 fenceValue, UINT64 commandCount)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// only allocators handed out by Acquire() can be given back
+	auto highWaterMark = m_highWaterMarks.find(pAllocator);
+	if (highWaterMark == m_highWaterMarks.end())
+	{
+		throw HrException(E_INVALIDARG);
+	}
+
+	RetiredAllocator retired;
+	retired.allocator = pAllocator;
+	retired.fenceValue = fenceValue;
+	retired.highWaterMark = max(highWaterMark->second, commandCount);
+	m_highWaterMarks.erase(highWaterMark);
+
+	m_highWaterMark = max(m_highWaterMark, retired.highWaterMark);
+	m_retiredAllocators[type].push_back(retired);
+}
+
+ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::CreateAllocator(D3D12_COMMAND_LIST_TYPE type)
+{
+	ComPtr<ID3D12CommandAllocator> allocator;
+	ThrowIfFailed(m_device->CreateCommandAllocator(type, IID_PPV_ARGS(&allocator)));
+	return allocator;
+}
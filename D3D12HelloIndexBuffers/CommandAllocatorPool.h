@@ -0,0 +1,68 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Hands out command allocators by command list type and recycles them once the gpu is
+// done with them. Every allocator given back is tagged with the fence value signaled
+// after the lists recorded into it, and is only reset and handed out again when the
+// fence has passed that value. This lets a frame use any number of lists, and lets
+// lists be recorded in the background without tying allocators to back buffers.
+//
+// An allocator keeps the memory of the largest recording it ever held, even across
+// Reset(). D3D12 doesn't report that memory, so the pool measures recordings by the number
+// of commands recorded into the allocator, which its memory grows with. It tracks that
+// high-water mark for each allocator and lets allocators that grew past
+// maxRetainedCommandCount commands go once they are retired, rather than reusing them.
+//
+// The pool never reads the fence itself, the caller passes in its completed value. With
+// CreateAllocator() overridden the bookkeeping can be driven without a device or fence.
+// Acquire() and Release() may be called from several threads.
+class CommandAllocatorPool
+{
+public:
+	static const UINT64 DefaultMaxRetainedCommandCount = 64 * 1024;
+
+	explicit CommandAllocatorPool(ID3D12Device* pDevice, UINT64 maxRetainedCommandCount = DefaultMaxRetainedCommandCount);
+	virtual ~CommandAllocatorPool() {}
+
+	// Returns a reset allocator of the given type, reusing the oldest retired one if the fence
+	// has passed it and creating a new one otherwise.
+	ComPtr<ID3D12CommandAllocator> Acquire(D3D12_COMMAND_LIST_TYPE type, UINT64 completedFenceValue);
+
+	// Gives an allocator back after the lists recorded into it were submitted. fenceValue is the
+	// value signaled after those lists, and commandCount how many commands all of them recorded
+	// into the allocator; every api call that records one counts, each barrier counts once.
+	// Allocators have to be released in the order their fence values are signaled.
+	void Release(D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator* pAllocator, UINT64 fenceValue, UINT64 commandCount);
+
+	UINT GetCreatedCount() const { return m_createdCount; } // allocators created over the pool's lifetime
+	UINT GetDiscardedCount() const { return m_discardedCount; } // allocators dropped for growing too large
+	UINT64 GetHighWaterMark() const { return m_highWaterMark; } // most commands any allocator held
+
+protected:
+	// creates a new allocator, tests can override this to hand out stand-ins
+	virtual ComPtr<ID3D12CommandAllocator> CreateAllocator(D3D12_COMMAND_LIST_TYPE type);
+
+private:
+	struct RetiredAllocator
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		UINT64 fenceValue; // the allocator is in use by the gpu until the fence reaches this value
+		UINT64 highWaterMark; // the largest recording the allocator held so far
+	};
+
+	ComPtr<ID3D12Device> m_device;
+	UINT64 m_maxRetainedCommandCount;
+	std::mutex m_mutex;
+	std::map<D3D12_COMMAND_LIST_TYPE, std::deque<RetiredAllocator>> m_retiredAllocators; // per type, in fence order
+	std::map<ID3D12CommandAllocator*, UINT64> m_highWaterMarks; // of the allocators currently handed out
+	UINT m_createdCount;
+	UINT m_discardedCount;
+	UINT64 m_highWaterMark;
+};
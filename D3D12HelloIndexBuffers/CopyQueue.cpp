@@ -0,0 +1,133 @@
+#include "stdafx.h"
+#include "CopyQueue.h"
+
+CopyQueue::CopyQueue(ID3D12Device* pDevice, CommandAllocatorPool* pAllocatorPool, UINT64 stagingSize) :
+	m_device(pDevice),
+	m_pAllocatorPool(pAllocatorPool),
+	m_fenceEvent(nullptr),
+	m_commandCount(0),
+	m_nextFenceValue(1),
+	m_waitTracker(nullptr),
+	m_waitCount(0)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_queue)));
+
+	ThrowIfFailed(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+	m_waitTracker = QueueWaitTracker<ID3D12CommandQueue, ID3D12Fence>(m_fence.Get());
+
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_fenceEvent == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	m_stagingRing = std::make_unique<UploadRingBuffer>(pDevice, m_fence.Get(), stagingSize);
+}
+
+CopyQueue::~CopyQueue()
+{
+	// the owner is responsible for flushing the queue first
+	CloseHandle(m_fenceEvent);
+}
+
+UINT64 CopyQueue::UploadBuffer(ID3D12Resource* pDestination, const void* pData, UINT64 size)
+{
+	// Data larger than the staging ring is copied in pieces of half the ring. Every piece but
+	// the last is submitted right away, so the copy queue reads one half while the cpu waits
+	// for and fills the other. Rings smaller than two aligned pieces still copy one at a time.
+	const UINT64 alignment = D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_ALIGNMENT;
+	const UINT64 maxPieceSize = max((m_stagingRing->GetSize() / 2) & ~(alignment - 1), alignment);
+	const UINT8* pSource = static_cast<const UINT8*>(pData);
+	for (UINT64 offset = 0; offset < size; )
+	{
+		const UINT64 pieceSize = min(size - offset, maxPieceSize);
+
+		// Staging memory only comes back once the copies reading it are submitted, so when the
+		// ring is full the copies recorded so far are sent off and Allocate() waits on the fence.
+		UploadRingBuffer::Allocation allocation;
+		if (!m_stagingRing->TryAllocate(pieceSize, alignment, &allocation))
+		{
+			Submit();
+			allocation = m_stagingRing->Allocate(pieceSize, alignment);
+		}
+		memcpy(allocation.pCpuAddress, pSource + offset, static_cast<size_t>(pieceSize));
+
+		// no barriers, the destination is promoted from COMMON to COPY_DEST implicitly
+		OpenCommandList();
+		m_commandList->CopyBufferRegion(pDestination, offset, allocation.pResource, allocation.offset, pieceSize);
+		m_commandCount++;
+
+		offset += pieceSize;
+		if (offset < size)
+		{
+			// start this piece now, the next allocation then only waits for the one before it
+			Submit();
+		}
+	}
+
+	return m_nextFenceValue;
+}
+
+void CopyQueue::OpenCommandList()
+{
+	// the list is opened on the first copy after a submit
+	if (m_commandAllocator)
+	{
+		return;
+	}
+
+	m_commandAllocator = m_pAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_COPY, m_fence->GetCompletedValue());
+	if (!m_commandList)
+	{
+		ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+	}
+	else
+	{
+		ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
+	}
+}
+
+UINT64 CopyQueue::Submit()
+{
+	if (!m_commandAllocator)
+	{
+		return m_nextFenceValue - 1;
+	}
+
+	ThrowIfFailed(m_commandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+	m_queue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	const UINT64 fenceValue = m_nextFenceValue++;
+	ThrowIfFailed(m_queue->Signal(m_fence.Get(), fenceValue));
+
+	// the staging memory and the allocator are in use until the copy queue passes the signal
+	m_stagingRing->Submit(fenceValue);
+	m_pAllocatorPool->Release(D3D12_COMMAND_LIST_TYPE_COPY, m_commandAllocator.Get(), fenceValue, m_commandCount);
+	m_commandAllocator.Reset();
+	m_commandCount = 0;
+
+	return fenceValue;
+}
+
+void CopyQueue::WaitOnQueue(ID3D12CommandQueue* pQueue, UINT64 fenceValue)
+{
+	if (m_waitTracker.Wait(pQueue, fenceValue))
+	{
+		m_waitCount++;
+	}
+}
+
+void CopyQueue::Flush()
+{
+	const UINT64 fenceValue = Submit();
+	if (m_fence->GetCompletedValue() < fenceValue)
+	{
+		ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+		WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+	}
+	m_stagingRing->Reclaim(fenceValue);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include "DXSampleHelper.h"
+#include "CommandAllocatorPool.h"
+#include "UploadRingBuffer.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Remembers how far each consumer queue already waited on a producer queue's fence, so a
+// consumer is only made to wait the first time it needs newer work. Waits for values the
+// fence has already passed are skipped too. It is a template so the ordering can be driven
+// by stand-in queue and fence types, all they need is Wait(Fence*, UINT64) on the queue
+// and GetCompletedValue() on the fence.
+template<typename Queue, typename Fence>
+class QueueWaitTracker
+{
+public:
+	explicit QueueWaitTracker(Fence* pFence) :
+		m_pFence(pFence)
+	{
+	}
+
+	// Makes pQueue wait on the gpu until the fence reaches fenceValue. Returns whether a wait was queued.
+	bool Wait(Queue* pQueue, UINT64 fenceValue)
+	{
+		UINT64& waitedValue = m_waitedValues[pQueue];
+		if (fenceValue <= waitedValue || fenceValue <= m_pFence->GetCompletedValue())
+		{
+			return false;
+		}
+
+		ThrowIfFailed(pQueue->Wait(m_pFence, fenceValue));
+		waitedValue = fenceValue;
+		return true;
+	}
+
+	// the value pQueue waited for last, everything signaled up to it is ordered before its later work
+	UINT64 GetWaitedValue(Queue* pQueue) const
+	{
+		auto it = m_waitedValues.find(pQueue);
+		return it != m_waitedValues.end() ? it->second : 0;
+	}
+
+private:
+	Fence* m_pFence;
+	std::map<Queue*, UINT64> m_waitedValues;
+};
+
+// A COPY queue with its own fence, staging memory and command lists, so uploads run
+// alongside rendering instead of in front of it. Copies are recorded with UploadBuffer()
+// and sent off with Submit(), which returns the fence value they complete at. Queues that
+// read the data call WaitOnQueue() with that value before the work that first uses it;
+// the wait happens on the gpu, the cpu never blocks on an upload.
+//
+// The copy queue can only use the COMMON and copy states, so destination buffers have to
+// be in COMMON. They decay back to it once the copy is done, and buffers are promoted from
+// COMMON implicitly on first use, so the other queues need no barriers for them either.
+// Not thread safe, every call belongs on the thread that submits.
+class CopyQueue
+{
+public:
+	CopyQueue(ID3D12Device* pDevice, CommandAllocatorPool* pAllocatorPool, UINT64 stagingSize);
+	~CopyQueue();
+
+	// Stages data and records a copy into the start of pDestination. Data larger than half the
+	// staging ring is copied in pieces that are submitted as they are recorded, waiting for the
+	// ring to free up as needed. Returns the fence value the copy is complete at, which is
+	// signaled by the next Submit().
+	UINT64 UploadBuffer(ID3D12Resource* pDestination, const void* pData, UINT64 size);
+
+	// Executes the copies recorded since the last call and signals the fence after them.
+	// Returns the fence value signaled, or the last one when nothing was recorded.
+	UINT64 Submit();
+
+	// Makes pQueue wait on the gpu until the copies up to fenceValue are done. Nothing is
+	// queued if pQueue already waited for them or they have completed.
+	void WaitOnQueue(ID3D12CommandQueue* pQueue, UINT64 fenceValue);
+
+	// Submits what was recorded and blocks until the copy queue is idle, meant for shutdown.
+	void Flush();
+
+	bool IsComplete(UINT64 fenceValue) const { return m_fence->GetCompletedValue() >= fenceValue; }
+	ID3D12CommandQueue* GetQueue() const { return m_queue.Get(); }
+	ID3D12Fence* GetFence() const { return m_fence.Get(); }
+	UINT GetWaitCount() const { return m_waitCount; } // gpu waits other queues actually queued
+
+private:
+	void OpenCommandList();
+
+	ComPtr<ID3D12Device> m_device;
+	CommandAllocatorPool* m_pAllocatorPool; // shared with the other queues, allocators are kept apart by type
+	ComPtr<ID3D12CommandQueue> m_queue;
+	ComPtr<ID3D12Fence> m_fence;
+	HANDLE m_fenceEvent;
+	std::unique_ptr<UploadRingBuffer> m_stagingRing; // retired against m_fence, not the fence of the queues reading the data
+	ComPtr<ID3D12CommandAllocator> m_commandAllocator; // allocator of the list while it records
+	ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	UINT64 m_commandCount; // copies recorded into the open list
+	UINT64 m_nextFenceValue; // value the next Submit() signals
+	QueueWaitTracker<ID3D12CommandQueue, ID3D12Fence> m_waitTracker;
+	UINT m_waitCount;
+};
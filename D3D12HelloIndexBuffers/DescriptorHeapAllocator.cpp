@@ -0,0 +1,63 @@
+#include "stdafx.h"
+#include "DescriptorHeapAllocator.h"
+
+DescriptorHeapAllocator::DescriptorHeapAllocator(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT descriptorsPerHeap) :
+	m_device(pDevice),
+	m_type(type),
+	m_descriptorsPerHeap(descriptorsPerHeap),
+	m_descriptorSize(pDevice->GetDescriptorHandleIncrementSize(type))
+{
+	AddHeap();
+}
+
+DescriptorHeapAllocator::Allocation DescriptorHeapAllocator::Allocate()
+{
+	if (m_freeIndices.empty())
+	{
+		AddHeap();
+	}
+
+	const UINT index = m_freeIndices.back();
+	m_freeIndices.pop_back();
+	m_allocated[index] = true;
+
+	Allocation allocation;
+	allocation.cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_heapStarts[index / m_descriptorsPerHeap], index % m_descriptorsPerHeap, m_descriptorSize);
+	allocation.index = index;
+	return allocation;
+}
+
+void DescriptorHeapAllocator::Free(const Allocation& allocation)
+{
+	// freeing a descriptor twice would hand it out to two owners
+	if (allocation.index >= GetCapacity() || !m_allocated[allocation.index])
+	{
+		throw HrException(E_INVALIDARG);
+	}
+
+	m_allocated[allocation.index] = false;
+	m_freeIndices.push_back(allocation.index);
+}
+
+void DescriptorHeapAllocator::AddHeap()
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = m_descriptorsPerHeap;
+	heapDesc.Type = m_type;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // only the cpu ever reads these
+
+	ComPtr<ID3D12DescriptorHeap> heap;
+	ThrowIfFailed(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+
+	const UINT firstIndex = GetCapacity();
+	m_heaps.push_back(heap);
+	m_heapStarts.push_back(heap->GetCPUDescriptorHandleForHeapStart());
+	m_allocated.resize(GetCapacity(), false);
+
+	// pushed in reverse so descriptors are handed out from the start of the heap
+	m_freeIndices.reserve(m_freeIndices.size() + m_descriptorsPerHeap);
+	for (UINT i = m_descriptorsPerHeap; i > 0; i--)
+	{
+		m_freeIndices.push_back(firstIndex + i - 1);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Hands out single descriptors from non shader visible heaps, such as RTVs, DSVs and
+// the staging copies of CBVs/SRVs/UAVs. Descriptors are numbered across a list of
+// equally sized heaps and the free ones are kept on a stack, so Allocate() and Free()
+// are O(1). A new heap is only created when every existing one is full; size the
+// allocator for the scene up front so that never happens on the frame path.
+class DescriptorHeapAllocator
+{
+public:
+	struct Allocation
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle; // where views are written
+		UINT index; // identifies the descriptor when it is freed
+	};
+
+	DescriptorHeapAllocator(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT descriptorsPerHeap);
+
+	Allocation Allocate();
+	void Free(const Allocation& allocation); // throws E_INVALIDARG for descriptors that aren't allocated
+
+	UINT GetCapacity() const { return static_cast<UINT>(m_heaps.size()) * m_descriptorsPerHeap; }
+	UINT GetAllocatedCount() const { return GetCapacity() - static_cast<UINT>(m_freeIndices.size()); }
+
+private:
+	void AddHeap();
+
+	ComPtr<ID3D12Device> m_device;
+	D3D12_DESCRIPTOR_HEAP_TYPE m_type;
+	UINT m_descriptorsPerHeap;
+	UINT m_descriptorSize; // increment between two descriptors in a heap, differs between devices
+	std::vector<ComPtr<ID3D12DescriptorHeap>> m_heaps;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_heapStarts; // cpu handle of the first descriptor of each heap
+	std::vector<UINT> m_freeIndices; // stack of free descriptors
+	std::vector<bool> m_allocated; // one bit per descriptor, catches descriptors freed twice
+};
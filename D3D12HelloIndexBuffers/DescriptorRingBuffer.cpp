@@ -0,0 +1,29 @@
+#include "stdafx.h"
+#include "DescriptorRingBuffer.h"
+
+DescriptorRingBuffer::DescriptorRingBuffer(ID3D12Device* pDevice, ID3D12Fence* pFence, UINT descriptorCount) :
+	m_descriptorSize(pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)),
+	m_ring(pFence, descriptorCount)
+{
+	// this is the heap the shaders see, it is created once and lives as long as the app
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = descriptorCount;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_heap)));
+
+	m_cpuBase = m_heap->GetCPUDescriptorHandleForHeapStart();
+	m_gpuBase = m_heap->GetGPUDescriptorHandleForHeapStart();
+}
+
+DescriptorRingBuffer::Allocation DescriptorRingBuffer::Allocate(UINT count)
+{
+	// a table has to be contiguous, the ring never splits an allocation across its end
+	const UINT offset = static_cast<UINT>(m_ring.Allocate(count, 1));
+
+	Allocation allocation;
+	allocation.cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cpuBase, offset, m_descriptorSize);
+	allocation.gpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpuBase, offset, m_descriptorSize);
+	allocation.offset = offset;
+	return allocation;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "DXSampleHelper.h"
+#include "RingAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// One large shader visible CBV_SRV_UAV heap that is carved up as a ring, for the
+// descriptor tables a frame builds and throws away. Tables are allocated as contiguous
+// ranges at the head and given back once the fence passes the submission that used them,
+// see RingAllocator. Only one shader visible heap can be bound at a time, so the whole
+// app shares this one.
+class DescriptorRingBuffer
+{
+public:
+	struct Allocation
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle; // where the views of the table are written or copied to
+		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle; // what is bound as the table
+		UINT offset; // index of the first descriptor in the heap
+	};
+
+	DescriptorRingBuffer(ID3D12Device* pDevice, ID3D12Fence* pFence, UINT descriptorCount);
+
+	// Allocates count contiguous descriptors, waiting for the gpu to retire older submissions if the ring is full.
+	Allocation Allocate(UINT count);
+
+	// Marks every allocation made since the last call as in use until the fence reaches fenceValue.
+	void Submit(UINT64 fenceValue) { m_ring.Submit(fenceValue); }
+
+	// Gives back the descriptors of every submission the gpu has finished with.
+	void Reclaim(UINT64 completedFenceValue) { m_ring.Reclaim(completedFenceValue); }
+
+	ID3D12DescriptorHeap* GetHeap() const { return m_heap.Get(); }
+	UINT GetDescriptorSize() const { return m_descriptorSize; }
+	UINT GetSize() const { return static_cast<UINT>(m_ring.GetSize()); }
+	UINT GetUsedCount() const { return static_cast<UINT>(m_ring.GetUsedSize()); }
+
+private:
+	ComPtr<ID3D12DescriptorHeap> m_heap;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_cpuBase;
+	D3D12_GPU_DESCRIPTOR_HANDLE m_gpuBase;
+	UINT m_descriptorSize;
+	RingAllocator m_ring; // in descriptors
+};
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "FrameLinearAllocator.h"
+
+namespace
+{
+	inline UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+FrameLinearAllocator::FrameLinearAllocator(ID3D12Device* pDevice, UINT frameCount, UINT64 bytesPerFrame) :
+	m_pCpuBase(nullptr),
+	m_gpuBase(0),
+	m_frameCount(frameCount),
+	m_bytesPerFrame(AlignUp(bytesPerFrame, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)), // every slot starts aligned for constant buffers
+	m_frameStart(0),
+	m_frameOffset(0),
+	m_highWaterMark(0)
+{
+	ThrowIfFailed(pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(m_bytesPerFrame * frameCount),
+		D3D12_RESOURCE_STATE_GENERIC_READ, // upload heaps have to stay in this state
+		nullptr,
+		IID_PPV_ARGS(&m_buffer)));
+
+	// Keep the buffer mapped for its whole lifetime. This memory is write combined,
+	// so it should only ever be written sequentially and never read by the cpu.
+	CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
+	ThrowIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pCpuBase)));
+	m_gpuBase = m_buffer->GetGPUVirtualAddress();
+}
+
+FrameLinearAllocator::~FrameLinearAllocator()
+{
+	// the owner is responsible for making sure the gpu is done with the buffer
+	m_buffer->Unmap(0, nullptr);
+}
+
+void FrameLinearAllocator::Reset(UINT frameIndex)
+{
+	m_frameStart = m_bytesPerFrame * (frameIndex % m_frameCount);
+	m_frameOffset = 0;
+}
+
+FrameLinearAllocator::Allocation FrameLinearAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+	const UINT64 offset = AlignUp(m_frameOffset, alignment);
+	if (offset + size > m_bytesPerFrame)
+	{
+		// the frame needs more transient memory than was reserved for it
+		throw HrException(E_OUTOFMEMORY);
+	}
+
+	m_frameOffset = offset + size;
+	m_highWaterMark = max(m_highWaterMark, m_frameOffset);
+
+	Allocation allocation;
+	allocation.pResource = m_buffer.Get();
+	allocation.offset = m_frameStart + offset;
+	allocation.pCpuAddress = m_pCpuBase + allocation.offset;
+	allocation.gpuAddress = m_gpuBase + allocation.offset;
+	return allocation;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS FrameLinearAllocator::AllocateConstantBuffer(const void* pData, UINT64 size)
+{
+	// constant buffer views have to start on a 256 byte boundary
+	Allocation allocation = Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	memcpy(allocation.pCpuAddress, pData, static_cast<size_t>(size));
+	return allocation.gpuAddress;
+}
+
+D3D12_VERTEX_BUFFER_VIEW FrameLinearAllocator::AllocateVertexBuffer(const void* pData, UINT vertexCount, UINT strideInBytes)
+{
+	const UINT size = vertexCount * strideInBytes;
+	Allocation allocation = Allocate(size, D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_ALIGNMENT);
+	memcpy(allocation.pCpuAddress, pData, size);
+
+	D3D12_VERTEX_BUFFER_VIEW view;
+	view.BufferLocation = allocation.gpuAddress;
+	view.StrideInBytes = strideInBytes;
+	view.SizeInBytes = size;
+	return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW FrameLinearAllocator::AllocateIndexBuffer(const void* pData, UINT indexCount, DXGI_FORMAT format)
+{
+	const UINT size = indexCount * (format == DXGI_FORMAT_R16_UINT ? 2 : 4);
+	Allocation allocation = Allocate(size, D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_ALIGNMENT);
+	memcpy(allocation.pCpuAddress, pData, size);
+
+	D3D12_INDEX_BUFFER_VIEW view;
+	view.BufferLocation = allocation.gpuAddress;
+	view.Format = format;
+	view.SizeInBytes = size;
+	return view;
+}
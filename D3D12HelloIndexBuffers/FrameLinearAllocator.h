@@ -0,0 +1,50 @@
+#pragma once
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Bump allocator for data that only lives for one frame, such as per-draw constants
+// and dynamic vertices. One persistently mapped upload buffer is split into a slot per
+// frame in flight. Allocating is a pointer bump inside the current frame's slot, and the
+// whole slot is recycled by Reset() once the gpu has finished the frame that last used it.
+class FrameLinearAllocator
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* pResource; // the upload buffer the allocation lives in
+		UINT64 offset; // offset of the allocation inside pResource
+		void* pCpuAddress; // where the cpu writes the data
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress; // where the gpu reads the data
+	};
+
+	FrameLinearAllocator(ID3D12Device* pDevice, UINT frameCount, UINT64 bytesPerFrame);
+	~FrameLinearAllocator();
+
+	// Starts allocating from the beginning of the frame's slot. The caller must have
+	// waited on the fence value of the frame that previously used this slot.
+	void Reset(UINT frameIndex);
+
+	// Allocates uninitialized memory from the current frame's slot.
+	Allocation Allocate(UINT64 size, UINT64 alignment);
+
+	// Copies the data into the current frame's slot and returns something the gpu can bind directly.
+	D3D12_GPU_VIRTUAL_ADDRESS AllocateConstantBuffer(const void* pData, UINT64 size);
+	D3D12_VERTEX_BUFFER_VIEW AllocateVertexBuffer(const void* pData, UINT vertexCount, UINT strideInBytes);
+	D3D12_INDEX_BUFFER_VIEW AllocateIndexBuffer(const void* pData, UINT indexCount, DXGI_FORMAT format);
+
+	UINT64 GetBytesPerFrame() const { return m_bytesPerFrame; }
+	UINT64 GetHighWaterMark() const { return m_highWaterMark; } // largest amount of memory any frame has used
+
+private:
+	ComPtr<ID3D12Resource> m_buffer;
+	UINT8* m_pCpuBase;
+	D3D12_GPU_VIRTUAL_ADDRESS m_gpuBase;
+
+	UINT m_frameCount;
+	UINT64 m_bytesPerFrame;
+	UINT64 m_frameStart; // offset of the current frame's slot
+	UINT64 m_frameOffset; // next free byte inside the current frame's slot
+	UINT64 m_highWaterMark;
+};
@@ -0,0 +1,184 @@
+#include "stdafx.h"
+#include "FramePacer.h"
+
+#include <cmath>
+
+// older sdks don't know the flag, the os just fails to create the timer when it doesn't either
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace
+{
+	const double EstimateWeight = 0.1; // how much each frame moves the running averages
+	const UINT64 WarmupFrameCount = 8; // frames measured before the predictor starts delaying
+	const size_t MaxPendingPresentCount = 16; // presents kept around while the statistics lag behind or are unavailable
+
+	inline double Blend(double average, double value)
+	{
+		return average + (value - average) * EstimateWeight;
+	}
+}
+
+FramePacer::FramePacer(IDXGISwapChain2* pSwapChain, UINT maxFrameLatency, bool justInTime) :
+	m_swapChain(pSwapChain),
+	m_waitableObject(nullptr),
+	m_delayTimer(nullptr),
+	m_maxFrameLatency(maxFrameLatency),
+	m_justInTime(justInTime),
+	m_lastSignalTicks(0),
+	m_frameStartTicks(0),
+	m_intervalEstimate(0.0),
+	m_workEstimate(0.0),
+	m_workDeviation(0.0),
+	m_totalDelayTicks(0),
+	m_frameCount(0),
+	m_firstFrameTicks(0),
+	m_lastFrameTicks(0),
+	m_totalLatencyTicks(0),
+	m_latencySampleCount(0)
+{
+	QueryPerformanceFrequency(&m_ticksPerSecond);
+
+	// at most this many frames are queued, Present() is never the call that blocks
+	ThrowIfFailed(pSwapChain->SetMaximumFrameLatency(maxFrameLatency));
+	m_waitableObject = pSwapChain->GetFrameLatencyWaitableObject();
+
+	// Sleep() is only accurate to the scheduler tick, which is most of a frame's slack
+	if (justInTime)
+	{
+		m_delayTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	}
+}
+
+FramePacer::~FramePacer()
+{
+	if (m_delayTimer)
+	{
+		CloseHandle(m_delayTimer);
+	}
+	CloseHandle(m_waitableObject);
+}
+
+void FramePacer::BeginFrame()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	if (m_firstFrameTicks == 0)
+	{
+		m_firstFrameTicks = now.QuadPart;
+	}
+
+	if (m_justInTime)
+	{
+		// When the cpu keeps up, the loop gets here right when the waitable object is
+		// signaled, so the time between calls is how often the swap chain takes a frame.
+		if (m_lastSignalTicks != 0)
+		{
+			const double interval = static_cast<double>(now.QuadPart - m_lastSignalTicks);
+			m_intervalEstimate = m_intervalEstimate == 0.0 ? interval : Blend(m_intervalEstimate, interval);
+		}
+		m_lastSignalTicks = now.QuadPart;
+
+		// Start late enough that the work ends just before the next signal. The margin covers
+		// frames that take longer than usual, if it's too small the frame misses its signal.
+		if (m_frameCount >= WarmupFrameCount)
+		{
+			const double margin = max(2.0 * m_workDeviation, static_cast<double>(m_ticksPerSecond.QuadPart) / 1000.0);
+			const LONGLONG delay = static_cast<LONGLONG>(m_intervalEstimate - m_workEstimate - margin);
+			if (delay > 0)
+			{
+				Delay(delay);
+				m_totalDelayTicks += delay;
+				QueryPerformanceCounter(&now);
+			}
+		}
+	}
+
+	m_frameStartTicks = now.QuadPart;
+}
+
+void FramePacer::EndFrame()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	const double work = static_cast<double>(now.QuadPart - m_frameStartTicks);
+	if (m_frameCount == 0)
+	{
+		m_workEstimate = work;
+	}
+	else
+	{
+		m_workDeviation = Blend(m_workDeviation, fabs(work - m_workEstimate));
+		m_workEstimate = Blend(m_workEstimate, work);
+	}
+	m_frameCount++;
+	m_lastFrameTicks = now.QuadPart;
+
+	// remember when this present's input was sampled until the statistics report it
+	UINT presentCount;
+	if (SUCCEEDED(m_swapChain->GetLastPresentCount(&presentCount)))
+	{
+		PendingPresent present = { presentCount, m_frameStartTicks };
+		m_pendingPresents.push_back(present);
+	}
+
+	// The statistics only describe the latest present that reached the screen. Presents
+	// older than it were shown or dropped while nobody looked and are not measured.
+	DXGI_FRAME_STATISTICS statistics;
+	if (SUCCEEDED(m_swapChain->GetFrameStatistics(&statistics)))
+	{
+		while (!m_pendingPresents.empty() && m_pendingPresents.front().presentCount < statistics.PresentCount)
+		{
+			m_pendingPresents.pop_front();
+		}
+		if (!m_pendingPresents.empty() && m_pendingPresents.front().presentCount == statistics.PresentCount)
+		{
+			const LONGLONG latency = statistics.SyncQPCTime.QuadPart - m_pendingPresents.front().sampleTicks;
+			if (latency > 0)
+			{
+				m_totalLatencyTicks += latency;
+				m_latencySampleCount++;
+			}
+			m_pendingPresents.pop_front();
+		}
+	}
+
+	while (m_pendingPresents.size() > MaxPendingPresentCount)
+	{
+		m_pendingPresents.pop_front();
+	}
+}
+
+double FramePacer::GetAverageLatency() const
+{
+	return m_latencySampleCount > 0 ? TicksToMilliseconds(static_cast<double>(m_totalLatencyTicks) / m_latencySampleCount) : 0.0;
+}
+
+double FramePacer::GetAverageDelay() const
+{
+	return m_frameCount > 0 ? TicksToMilliseconds(static_cast<double>(m_totalDelayTicks) / m_frameCount) : 0.0;
+}
+
+double FramePacer::GetAverageFrameTime() const
+{
+	return m_frameCount > 0 ? TicksToMilliseconds(static_cast<double>(m_lastFrameTicks - m_firstFrameTicks) / m_frameCount) : 0.0;
+}
+
+void FramePacer::Delay(LONGLONG ticks)
+{
+	if (m_delayTimer)
+	{
+		// negative due times are relative, in 100 ns units
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(ticks * 10000000 / m_ticksPerSecond.QuadPart);
+		if (SetWaitableTimer(m_delayTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+		{
+			WaitForSingleObjectEx(m_delayTimer, INFINITE, FALSE);
+			return;
+		}
+	}
+
+	Sleep(static_cast<DWORD>(ticks * 1000 / m_ticksPerSecond.QuadPart));
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <deque>
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Limits how many frames the swap chain queues up, and optionally starts each frame just in
+// time for it to finish when the display wants it rather than as early as the queue allows.
+//
+// The swap chain has to be created with DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT.
+// Its waitable object is signaled whenever the queue has room for another frame, the message
+// loop waits on it before starting one. With the predictor enabled BeginFrame() then delays
+// the frame by however long the last frames left the cpu idle before the next signal, minus
+// a safety margin, so input is sampled as late as possible.
+//
+// The latency from BeginFrame() to the vblank the frame is shown at is measured with the
+// swap chain's frame statistics. It is only available where the statistics are, which
+// excludes some windowed configurations.
+class FramePacer
+{
+public:
+	FramePacer(IDXGISwapChain2* pSwapChain, UINT maxFrameLatency, bool justInTime);
+	~FramePacer();
+
+	// signaled when the swap chain can take another frame
+	HANDLE GetWaitableObject() const { return m_waitableObject; }
+
+	// Call once the waitable object was signaled, before any input is sampled for the frame.
+	void BeginFrame();
+
+	// Call right after Present().
+	void EndFrame();
+
+	UINT GetMaxFrameLatency() const { return m_maxFrameLatency; }
+	UINT64 GetLatencySampleCount() const { return m_latencySampleCount; } // frames the latency could be measured for
+	double GetAverageLatency() const; // milliseconds from BeginFrame() to the vblank the frame was shown at
+	double GetAverageDelay() const; // milliseconds the predictor delayed each frame on average
+	double GetAverageFrameTime() const; // milliseconds from one BeginFrame() to the next, on average
+	UINT64 GetFrameCount() const { return m_frameCount; }
+
+private:
+	// time the frame's input was sampled, waiting for the statistics to report its present
+	struct PendingPresent
+	{
+		UINT presentCount;
+		LONGLONG sampleTicks;
+	};
+
+	void Delay(LONGLONG ticks);
+	double TicksToMilliseconds(double ticks) const { return ticks * 1000.0 / static_cast<double>(m_ticksPerSecond.QuadPart); }
+
+	ComPtr<IDXGISwapChain2> m_swapChain;
+	HANDLE m_waitableObject;
+	HANDLE m_delayTimer; // high resolution timer for the delay, null where the os has none
+	UINT m_maxFrameLatency;
+	bool m_justInTime;
+	LARGE_INTEGER m_ticksPerSecond;
+
+	// the predictor, all in qpc ticks
+	LONGLONG m_lastSignalTicks; // when BeginFrame() was last called, as close to the signal as the loop gets
+	LONGLONG m_frameStartTicks; // when the current frame started after the delay
+	double m_intervalEstimate; // running average of the time between signals
+	double m_workEstimate; // running average of the cpu time from frame start to present
+	double m_workDeviation; // running average of how far the cpu time strays from m_workEstimate
+	LONGLONG m_totalDelayTicks;
+	UINT64 m_frameCount;
+	LONGLONG m_firstFrameTicks; // when BeginFrame() was first called
+	LONGLONG m_lastFrameTicks; // when EndFrame() was last called
+
+	std::deque<PendingPresent> m_pendingPresents; // in present order
+	LONGLONG m_totalLatencyTicks;
+	UINT64 m_latencySampleCount;
+};
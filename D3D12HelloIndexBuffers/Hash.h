@@ -0,0 +1,39 @@
+#pragma once
+
+// Incremental 64-bit FNV-1a hash, used to build cache keys out of
+// pipeline descriptions and shader sources.
+class Hasher
+{
+public:
+	Hasher() : m_value(14695981039346656037ull) {}
+
+	void Add(const void* pData, size_t size)
+	{
+		const UINT8* pBytes = static_cast<const UINT8*>(pData);
+		for (size_t i = 0; i < size; i++)
+		{
+			m_value ^= pBytes[i];
+			m_value *= 1099511628211ull;
+		}
+	}
+
+	// hash the bytes of a plain old data value, structs must not contain pointers or padding
+	template<typename T>
+	void AddValue(const T& value)
+	{
+		Add(&value, sizeof(value));
+	}
+
+	// hash a null terminated string, including its length so "ab" + "c" and "a" + "bc" differ
+	void AddString(const char* pString)
+	{
+		const size_t length = pString ? strlen(pString) : 0;
+		AddValue(length);
+		Add(pString, length);
+	}
+
+	UINT64 GetValue() const { return m_value; }
+
+private:
+	UINT64 m_value;
+};
@@ -0,0 +1,120 @@
+// Console entry point of the portable headless build. It renders the same frames as
+// HelloIndexBuffers -headless and prints the same report, but only uses the C++ standard
+// library, so it builds and runs on machines without Windows or a GPU (see CMakeLists.txt).
+// The arguments are the headless subset of the sample's:
+//   -headless         accepted and ignored, this build is always headless
+//   -frames <count>   number of frames to render
+//   -draws <count>    number of times the quad is drawn each frame
+//   -instances <count> number of quads each draw covers
+//   -noinstancing     draw the quads one by one instead of with one instanced draw
+
+#include "HeadlessRenderer.h"
+#include "QuadMesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	const char* const Title = "D3D12 Hello Index Buffers";
+	const uint32_t Width = 800; // same size as the window of the sample
+	const uint32_t Height = 600;
+
+	// matches both spellings the sample accepts, -name and /name
+	bool IsOption(const char* pArgument, const char* pName)
+	{
+		return (pArgument[0] == '-' || pArgument[0] == '/') && strcmp(pArgument + 1, pName) == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t frameCount = 1000;
+	uint32_t drawCount = 1;
+	uint32_t instanceCount = 1;
+	bool instancing = true;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (IsOption(argv[i], "frames") && i + 1 < argc)
+		{
+			frameCount = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (IsOption(argv[i], "draws") && i + 1 < argc)
+		{
+			drawCount = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (IsOption(argv[i], "instances") && i + 1 < argc)
+		{
+			const int count = atoi(argv[++i]);
+			instanceCount = static_cast<uint32_t>((std::max)(1, count));
+		}
+		else if (IsOption(argv[i], "noinstancing"))
+		{
+			instancing = false;
+		}
+	}
+
+	const std::vector<QuadInstance> instances = CreateQuadInstances(instanceCount);
+
+	HeadlessRenderer::Desc desc = {};
+	desc.width = Width;
+	desc.height = Height;
+	desc.inputLayout.strideInBytes = sizeof(QuadVertex);
+	desc.inputLayout.positionOffset = offsetof(QuadVertex, position);
+	desc.inputLayout.colorOffset = offsetof(QuadVertex, color);
+	desc.inputLayout.instanceStrideInBytes = sizeof(QuadInstance);
+	desc.inputLayout.instanceTransformOffset = offsetof(QuadInstance, transform);
+	desc.inputLayout.instanceColorOffset = offsetof(QuadInstance, color);
+	desc.pVertices = QuadVertices;
+	desc.vertexCount = sizeof(QuadVertices) / sizeof(QuadVertices[0]);
+	desc.pIndices = QuadIndices;
+	desc.indexCount = sizeof(QuadIndices) / sizeof(QuadIndices[0]);
+	desc.pInstances = instances.data();
+	desc.instanceCount = instanceCount;
+	HeadlessRenderer renderer(desc);
+
+	// the scene constants of the sample, nothing moves
+	const SoftwareRasterizer::SceneConstants constants = {};
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::duration totalTime = Clock::duration::zero();
+	Clock::duration minTime = Clock::duration::max();
+	Clock::duration maxTime = Clock::duration::zero();
+
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		const Clock::time_point start = Clock::now();
+
+		renderer.SetSceneConstants(constants);
+		renderer.Render(drawCount, instancing);
+
+		const Clock::duration time = Clock::now() - start;
+		totalTime += time;
+		minTime = (std::min)(minTime, time);
+		maxTime = (std::max)(maxTime, time);
+	}
+
+	if (frameCount > 0)
+	{
+		typedef std::chrono::duration<double, std::milli> Milliseconds;
+		printf("%s: %u frames, avg %.3f ms, min %.3f ms, max %.3f ms\n",
+			Title,
+			frameCount,
+			Milliseconds(totalTime).count() / frameCount,
+			Milliseconds(minTime).count(),
+			Milliseconds(maxTime).count());
+
+		const MeshOptimizer::CacheStatistics& inputStatistics = renderer.GetInputStatistics();
+		const MeshOptimizer::CacheStatistics& outputStatistics = renderer.GetOutputStatistics();
+		printf("%s: vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			Title, inputStatistics.acmr, outputStatistics.acmr, inputStatistics.atvr, outputStatistics.atvr);
+		fflush(stdout);
+	}
+
+	return 0;
+}
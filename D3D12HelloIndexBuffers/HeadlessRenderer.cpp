@@ -0,0 +1,49 @@
+#include "HeadlessRenderer.h"
+
+#include <cstddef>
+
+HeadlessRenderer::HeadlessRenderer(const Desc& desc) :
+	m_rasterizer(desc.width, desc.height),
+	m_meshOptimizer(desc.pIndices, desc.indexCount, desc.vertexCount),
+	m_instanceCount(desc.instanceCount)
+{
+	m_rasterizer.SetInputLayout(desc.inputLayout);
+
+	m_vertices.resize(static_cast<size_t>(m_meshOptimizer.GetVertexCount()) * desc.inputLayout.strideInBytes);
+	m_meshOptimizer.RemapVertices(desc.pVertices, desc.inputLayout.strideInBytes, m_vertices.data());
+	m_rasterizer.SetVertexBuffer(m_vertices.data(), static_cast<uint32_t>(m_vertices.size()));
+	m_rasterizer.SetIndexBuffer(m_meshOptimizer.GetIndices().data(), m_meshOptimizer.GetIndexCount() * sizeof(uint32_t));
+
+	if (desc.pInstances)
+	{
+		const uint8_t* pInstances = static_cast<const uint8_t*>(desc.pInstances);
+		m_instances.assign(pInstances, pInstances + static_cast<size_t>(desc.instanceCount) * desc.inputLayout.instanceStrideInBytes);
+		m_rasterizer.SetInstanceBuffer(m_instances.data(), static_cast<uint32_t>(m_instances.size()));
+	}
+
+	// the whole target, like the viewport and scissor rect of the window
+	m_rasterizer.SetViewport({ 0.0f, 0.0f, static_cast<float>(desc.width), static_cast<float>(desc.height) });
+	m_rasterizer.SetScissorRect({ 0, 0, static_cast<int32_t>(desc.width), static_cast<int32_t>(desc.height) });
+}
+
+// The software equivalent of PopulateCommandList() and ExecuteCommandLists()
+void HeadlessRenderer::Render(uint32_t drawCount, bool instancing)
+{
+	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+	m_rasterizer.ClearRenderTarget(clearColor);
+	const uint32_t indexCount = m_meshOptimizer.GetIndexCount();
+	for (uint32_t i = 0; i < drawCount; i++)
+	{
+		if (instancing)
+		{
+			m_rasterizer.DrawIndexedInstanced(indexCount, m_instanceCount, 0, 0, 0);
+		}
+		else
+		{
+			for (uint32_t instance = 0; instance < m_instanceCount; instance++)
+			{
+				m_rasterizer.DrawIndexedInstanced(indexCount, 1, 0, 0, instance);
+			}
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MeshOptimizer.h"
+#include "SoftwareRasterizer.h"
+
+// Everything the headless path renders with: the mesh is optimized the way the d3d12 path
+// imports it and then drawn by the software rasterizer, read in place with nothing to upload.
+// Used by HelloIndexBuffers -headless and by the portable console build in HeadlessMain.cpp,
+// so like the software rasterizer this only depends on the C++ standard library.
+class HeadlessRenderer
+{
+public:
+	struct Desc
+	{
+		uint32_t width; // render target size
+		uint32_t height;
+		SoftwareRasterizer::InputLayout inputLayout; // of the vertices and the instances
+		const void* pVertices;
+		uint32_t vertexCount;
+		const uint32_t* pIndices; // triangle list
+		uint32_t indexCount;
+		const void* pInstances; // may be null, every instance is then drawn untransformed
+		uint32_t instanceCount;
+	};
+
+	// copies the vertices and instances, the caller's data doesn't have to stay alive
+	explicit HeadlessRenderer(const Desc& desc);
+
+	void SetSceneConstants(const SoftwareRasterizer::SceneConstants& constants) { m_rasterizer.SetSceneConstants(constants); }
+
+	// Clears the target and draws the mesh drawCount times, each time covering every instance
+	// with one instanced draw or, without instancing, with one draw per instance.
+	void Render(uint32_t drawCount, bool instancing);
+
+	const MeshOptimizer::CacheStatistics& GetInputStatistics() const { return m_meshOptimizer.GetInputStatistics(); } // as authored
+	const MeshOptimizer::CacheStatistics& GetOutputStatistics() const { return m_meshOptimizer.GetOutputStatistics(); } // after optimizing
+	const SoftwareRasterizer& GetRasterizer() const { return m_rasterizer; }
+
+private:
+	SoftwareRasterizer m_rasterizer;
+	MeshOptimizer m_meshOptimizer; // owns the optimized indices
+	std::vector<uint8_t> m_vertices; // in the optimized order
+	std::vector<uint8_t> m_instances;
+	uint32_t m_instanceCount;
+};
@@ -1,15 +1,60 @@
 #include "stdafx.h"
 #include "HelloIndexBuffers.h"
+#include "Hash.h"
+
+namespace
+{
+	// Maps a precompiled shader and returns its bytecode, which points into the mapping.
+	D3D12_SHADER_BYTECODE LoadShaderBytecode(MappedFile& file, LPCWSTR fileName)
+	{
+		if (!file.Open(fileName))
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+		}
+
+		return CD3DX12_SHADER_BYTECODE(file.GetData(), file.GetSize());
+	}
+
+	// names of the present modes on the command line, in the order of PresentMode
+	const WCHAR* const PresentModeNames[] = { L"vsync", L"mailbox", L"tearing", L"none" };
+
+	// the second input slot, read once per instance instead of once per vertex
+	const D3D12_INPUT_ELEMENT_DESC InstanceInputElementDescs[] =
+	{
+		{ "INSTANCETRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCECOLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
+	};
+}
 
 HelloIndexBuffers::HelloIndexBuffers(UINT width, UINT height, wstring name) :
 	m_width(width),
 	m_height(height),
 	m_title(name),
+	m_headless(false),
+	m_headlessFrameCount(1000),
+	m_drawCount(1),
+	m_instanceCount(1),
+	m_instancing(true),
+	m_indirect(false),
+	m_maxFrameLatency(1),
+	m_justInTime(false),
+	m_presentMode(PresentModeVSync),
+	m_occluded(false),
 	m_frameIndex(0),
 	m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
 	m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
 	m_fenceValues{},
-	m_rtvDescriptorSize(0)
+	m_commandCount(0),
+	m_workerCommandCounts{},
+	m_constantBufferData{},
+	m_sceneDescriptorTable{},
+	m_geometryFenceValue(0),
+	m_primitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST),
+	m_instanceBufferView{},
+	m_indirectArgumentAllocation{},
+	m_rtvDescriptors{},
+	m_inputCacheStatistics{},
+	m_outputCacheStatistics{}
 {
 }
 
@@ -19,6 +64,14 @@ HelloIndexBuffers::~HelloIndexBuffers()
 
 void HelloIndexBuffers::OnInit()
 {
+	CreateInstances();
+
+	if (m_headless)
+	{
+		LoadSoftwarePipeline();
+		return;
+	}
+
 	LoadPipeline();
 	LoadResource();
 }
@@ -26,32 +79,222 @@ void HelloIndexBuffers::OnInit()
 // Update frame-based values
 void HelloIndexBuffers::OnUpdate()
 {
+	if (m_headless)
+	{
+		SoftwareRasterizer::SceneConstants constants;
+		memcpy(constants.offset, &m_constantBufferData.offset, sizeof(constants.offset));
+		m_headlessRenderer->SetSceneConstants(constants);
+		return;
+	}
+
+	// the swap chain has room for this frame, the pacer may still hold it back to start it just in time
+	m_framePacer->BeginFrame();
 
+	// Per frame data is written into this frame's slot of the frame allocator, which
+	// only costs a pointer bump. It stays valid until the gpu has finished the frame.
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = m_frameAllocator->AllocateConstantBuffer(&m_constantBufferData, sizeof(m_constantBufferData));
+	cbvDesc.SizeInBytes = sizeof(m_constantBufferData);
+
+	// the view goes into a table of the descriptor ring, which is given back with the frame
+	const DescriptorRingBuffer::Allocation table = m_descriptorRing->Allocate(1);
+	m_device->CreateConstantBufferView(&cbvDesc, table.cpuHandle);
+	m_sceneDescriptorTable = table.gpuHandle;
+	m_instanceBufferView = m_frameAllocator->AllocateVertexBuffer(m_instances.data(), m_instanceCount, sizeof(Instance));
+
+	// upload heaps are always readable as indirect arguments, there is nothing to transition
+	if (m_indirect)
+	{
+		m_indirectArgumentAllocation = m_frameAllocator->Allocate(m_indirectArguments.GetDataSize(), sizeof(UINT));
+		memcpy(m_indirectArgumentAllocation.pCpuAddress, m_indirectArguments.GetData(), m_indirectArguments.GetDataSize());
+	}
 }
 
 // Render the scene
 void HelloIndexBuffers::OnRender()
 {
+	if (m_headless)
+	{
+		m_headlessRenderer->Render(m_drawCount, m_instancing);
+		return;
+	}
+
 	// record all the commands we need to render the scene into the command list
 	PopulateCommandList();
 
-	// execute the command list
-	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	// The draws read the geometry, so the direct queue waits on the gpu for the copies
+	// that uploaded it. Only the first frame after an upload actually queues a wait.
+	m_copyQueue->WaitOnQueue(m_commandQueue.Get(), m_geometryFenceValue);
+
+	// execute the command lists, in the order they have to run on the gpu
+	{
+		// held while the barriers are resolved and the final states committed, released on any exception too
+		std::unique_lock<std::mutex> stateLock = ResourceStateTracker::LockGlobalState();
+		ID3D12CommandList* ppCommandLists[RecordingThreadCount + 3];
+		UINT commandListCount = 0;
+		if (PopulateBarrierCommandList())
+		{
+			ppCommandLists[commandListCount++] = m_barrierCommandList.Get();
+		}
+		ppCommandLists[commandListCount++] = m_commandList.Get();
+		for (UINT i = 0; i < RecordingThreadCount; i++)
+		{
+			ppCommandLists[commandListCount++] = m_workerCommandLists[i].Get();
+		}
+		ppCommandLists[commandListCount++] = m_postCommandList.Get();
+		m_commandQueue->ExecuteCommandLists(commandListCount, ppCommandLists);
+		m_stateTracker.CommitFinalResourceStates();
+	}
 
-	// present the frame
-	ThrowIfFailed(m_swapChain->Present(1, 0));
+	// the allocators and descriptor tables are in use until the fence value MoveToNextFrame() signals is reached
+	const UINT64 fenceValue = m_fenceValues[m_frameIndex];
+	m_descriptorRing->Submit(fenceValue);
+	m_commandAllocatorPool->Release(D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), fenceValue, m_commandCount);
+	m_commandAllocator.Reset();
+	for (UINT i = 0; i < RecordingThreadCount; i++)
+	{
+		m_commandAllocatorPool->Release(D3D12_COMMAND_LIST_TYPE_DIRECT, m_workerCommandAllocators[i].Get(), fenceValue, m_workerCommandCounts[i]);
+		m_workerCommandAllocators[i].Reset();
+	}
+
+	// Present the frame. DXGI_STATUS_OCCLUDED isn't an error, it means nothing of the
+	// window is visible and the message loop can stop rendering until that changes.
+	// Only vsync waits for the vblank, the other modes run as fast as the cpu and gpu allow.
+	if (m_presentMode != PresentModeNone)
+	{
+		const UINT syncInterval = m_presentMode == PresentModeVSync ? 1 : 0;
+		const UINT presentFlags = m_presentMode == PresentModeTearing ? DXGI_PRESENT_ALLOW_TEARING : 0;
+		const HRESULT hr = m_swapChain->Present(syncInterval, presentFlags);
+		ThrowIfFailed(hr);
+		m_occluded = hr == DXGI_STATUS_OCCLUDED;
+	}
+	m_framePacer->EndFrame();
 
 	MoveToNextFrame();
 }
 
 void HelloIndexBuffers::OnDestroy()
 {
+	if (m_headless)
+	{
+		m_headlessRenderer.reset();
+		return;
+	}
+
 	// Ensure that the GPU is no longer referencing resources that are about to be
-	// cleaned up by the destructor.
+	// cleaned up by the destructor, on both queues.
 	WaitForGPU();
+	m_copyQueue->Flush();
 
 	CloseHandle(m_fenceEvent);
+
+	for (UINT n = 0; n < FrameCount; n++)
+	{
+		ResourceStateTracker::RemoveGlobalResourceState(m_renderTargets[n].Get());
+	}
+	ResourceStateTracker::RemoveGlobalResourceState(m_vertexBuffer.Get());
+	ResourceStateTracker::RemoveGlobalResourceState(m_indexBuffer.Get());
+
+	// write any psos compiled during this run to the cache file
+	m_pipelineCache->Save();
+
+	// report how many barriers batching saved
+	WCHAR message[256];
+	swprintf_s(message, L"%ls: %llu barriers requested, %llu emitted in %llu ResourceBarrier calls\n",
+		m_title.c_str(), m_stateTracker.GetBarriers().GetRequestedCount(), m_stateTracker.GetBarriers().GetEmittedCount(), m_stateTracker.GetBarriers().GetFlushCount());
+	OutputDebugStringW(message);
+
+	// report the latency from the start of a frame to the vblank it was shown at
+	swprintf_s(message, L"%ls: %.3f ms sample to present latency over %llu frames, at most %u queued, %.3f ms just in time delay\n",
+		m_title.c_str(), m_framePacer->GetAverageLatency(), m_framePacer->GetLatencySampleCount(), m_framePacer->GetMaxFrameLatency(), m_framePacer->GetAverageDelay());
+	OutputDebugStringW(message);
+
+	// without vsync this is what the frame itself costs rather than the refresh rate
+	swprintf_s(message, L"%ls: %llu frames with %ls presents, %.3f ms per frame (%.1f fps)\n",
+		m_title.c_str(), m_framePacer->GetFrameCount(), PresentModeNames[m_presentMode], m_framePacer->GetAverageFrameTime(),
+		m_framePacer->GetAverageFrameTime() > 0.0 ? 1000.0 / m_framePacer->GetAverageFrameTime() : 0.0);
+	OutputDebugStringW(message);
+}
+
+// Tests whether the window is still occluded, without presenting anything
+bool HelloIndexBuffers::IsOccluded()
+{
+	if (m_occluded)
+	{
+		m_occluded = m_swapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED;
+	}
+	return m_occluded;
+}
+
+// Handle the command line arguments
+//   -headless         render with the software rasterizer, without a window or a GPU
+//   -frames <count>   number of frames to render in headless mode
+//   -draws <count>    number of times the quad is drawn each frame
+//   -instances <count> number of quads each draw covers
+//   -noinstancing     draw the quads one by one instead of with one instanced draw
+//   -indirect         submit every draw of the frame with one ExecuteIndirect
+//   -latency <frames> most frames the swap chain queues before the next one waits, 1 by default
+//   -jit              delay the start of each frame so the cpu finishes it just in time
+//   -present <mode>   vsync (default), mailbox, tearing or none to render without presenting
+void HelloIndexBuffers::ParseCommandLineArgs(WCHAR* argv[], int argc)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (_wcsicmp(argv[i], L"-headless") == 0 || _wcsicmp(argv[i], L"/headless") == 0)
+		{
+			m_headless = true;
+		}
+		else if ((_wcsicmp(argv[i], L"-frames") == 0 || _wcsicmp(argv[i], L"/frames") == 0) && i + 1 < argc)
+		{
+			m_headlessFrameCount = static_cast<UINT>(_wtoi(argv[++i]));
+		}
+		else if ((_wcsicmp(argv[i], L"-draws") == 0 || _wcsicmp(argv[i], L"/draws") == 0) && i + 1 < argc)
+		{
+			m_drawCount = static_cast<UINT>(_wtoi(argv[++i]));
+		}
+		else if ((_wcsicmp(argv[i], L"-instances") == 0 || _wcsicmp(argv[i], L"/instances") == 0) && i + 1 < argc)
+		{
+			// read the argument once, max() is the windows.h macro and evaluates it twice
+			const int instanceCount = _wtoi(argv[++i]);
+			m_instanceCount = max(1, instanceCount);
+		}
+		else if (_wcsicmp(argv[i], L"-noinstancing") == 0 || _wcsicmp(argv[i], L"/noinstancing") == 0)
+		{
+			m_instancing = false;
+		}
+		else if (_wcsicmp(argv[i], L"-indirect") == 0 || _wcsicmp(argv[i], L"/indirect") == 0)
+		{
+			m_indirect = true;
+		}
+		else if ((_wcsicmp(argv[i], L"-latency") == 0 || _wcsicmp(argv[i], L"/latency") == 0) && i + 1 < argc)
+		{
+			const int maxFrameLatency = _wtoi(argv[++i]);
+			m_maxFrameLatency = min(max(1, maxFrameLatency), DXGI_MAX_SWAP_CHAIN_BUFFERS);
+		}
+		else if (_wcsicmp(argv[i], L"-jit") == 0 || _wcsicmp(argv[i], L"/jit") == 0)
+		{
+			m_justInTime = true;
+		}
+		else if ((_wcsicmp(argv[i], L"-present") == 0 || _wcsicmp(argv[i], L"/present") == 0) && i + 1 < argc)
+		{
+			const WCHAR* pModeName = argv[++i];
+			UINT mode = 0;
+			while (mode < _countof(PresentModeNames) && _wcsicmp(pModeName, PresentModeNames[mode]) != 0)
+			{
+				mode++;
+			}
+
+			// falling back to vsync would measure something else than what was asked for
+			if (mode == _countof(PresentModeNames))
+			{
+				WCHAR message[256];
+				swprintf_s(message, L"Unknown present mode %ls, expected vsync, mailbox, tearing or none\n", pModeName);
+				OutputDebugStringW(message);
+				throw HrException(E_INVALIDARG);
+			}
+			m_presentMode = static_cast<PresentMode>(mode);
+		}
+	}
 }
 
 // Load the rendering pipeline dependencies
@@ -85,6 +328,20 @@ void HelloIndexBuffers::LoadPipeline()
 
 	// -- Create Swap Chain -- //
 
+	// Tearing needs a swap chain flag that dxgi only accepts when the os and the driver support it
+	if (m_presentMode == PresentModeTearing)
+	{
+		BOOL allowTearing = FALSE;
+		ComPtr<IDXGIFactory5> dxgiFactory5;
+		if (FAILED(dxgiFactory.As(&dxgiFactory5)) ||
+			FAILED(dxgiFactory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))) ||
+			!allowTearing)
+		{
+			OutputDebugStringW(L"Tearing presents are not supported, presenting without vsync instead\n");
+			m_presentMode = PresentModeMailbox;
+		}
+	}
+
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {}; // describe a swap chain
 	swapChainDesc.BufferCount = FrameCount;
 	swapChainDesc.Width = m_width; // buffer width
@@ -93,6 +350,11 @@ void HelloIndexBuffers::LoadPipeline()
 	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT; // this says the pipeline will render to this swap chain
 	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD; // dxgi will discard the buffer (data) after we call present
 	swapChainDesc.SampleDesc.Count = 1; // describe our multi-sampling. We are not multi-sampling, so we set the count to 1 (we need at least one sample of course)
+	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT; // the message loop waits for the swap chain to have room for a frame before starting one
+	if (m_presentMode == PresentModeTearing)
+	{
+		swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING; // lets Present() show frames mid-scanout
+	}
 
 	ComPtr<IDXGISwapChain1> swapChain; 
 	ThrowIfFailed(dxgiFactory->CreateSwapChainForHwnd(
@@ -110,243 +372,589 @@ void HelloIndexBuffers::LoadPipeline()
 	ThrowIfFailed(swapChain.As(&m_swapChain));
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
-	// -- Create Render Target Descriptor Heap -- //
-
-	{
-		D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {}; // describe a render target view (RTV) descriptor heap
-		rtvHeapDesc.NumDescriptors = FrameCount;
-		rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV; // this heap will not be directly referenced by the shaders (not shader visible), as this will store the output from the pipeline
-													       // otherwise we would set the heap's flag to D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
-		rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-		ThrowIfFailed(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvDescriptorHeap)));
+	// Without a limit dxgi queues up to three frames, each adding a refresh of input latency.
+	m_framePacer = make_unique<FramePacer>(m_swapChain.Get(), m_maxFrameLatency, m_justInTime);
 
-		// get the size of a descriptor in this heap (this is a rtv heap, so only rtv descriptors should be stored in it.
-		// descriptor sizes may vary from device to device, which is why there is no set size and we must ask the 
-		// device to give us the size. we will use this size to increment a descriptor handle offset
-		m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-	}
+	// -- Create Descriptor Allocators -- //
 
 	{
-		// get a handle to the first descriptor in the descriptor heap. a handle is basically a pointer,
-		// but we cannot literally use it like a c++ pointer.
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+		// Render target views are never referenced by the shaders (not shader visible), as they
+		// store the output from the pipeline. They come from a free list over cpu only heaps, sized
+		// so no heap has to be created later on.
+		m_rtvAllocator = make_unique<DescriptorHeapAllocator>(m_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, RtvDescriptorCount);
 
 		// create a RTV for each frame buffer (double buffering is two buffers, tripple buffering is 3).
 		for (UINT n = 0; n < FrameCount; n++)
 		{
 			// first we get the n'th buffer in the swap chain and store it in the n'th position of our ID3D12Resource array
 			ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
-			// we "create" a render target view which binds the swap chain buffer (ID3D12Resource[n]) to the rtv handle
-			m_device->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, rtvHandle);
-			// we increment the rtv handle by the rtv descriptor size we got above
-			rtvHandle.Offset(1, m_rtvDescriptorSize);
-
-			// -- Create Command Allocators -- //
-			ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[n])));
+			ResourceStateTracker::AddGlobalResourceState(m_renderTargets[n].Get(), D3D12_RESOURCE_STATE_PRESENT);
+			// we "create" a render target view which binds the swap chain buffer (ID3D12Resource[n]) to its descriptor
+			m_rtvDescriptors[n] = m_rtvAllocator->Allocate();
+			m_device->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, m_rtvDescriptors[n].cpuHandle);
 		}
 	}
 
-	
+	// -- Create Command Allocator Pool -- //
+
+	// Allocators aren't tied to back buffers, every list takes one from the pool when it starts
+	// recording and gives it back tagged with the fence value that retires it.
+	m_commandAllocatorPool = make_unique<CommandAllocatorPool>(m_device.Get());
+
+	// -- Create Worker Threads -- //
+
+	// used to compile shaders and psos in parallel at startup, and to record the frame's draws
+	m_threadPool = make_unique<ThreadPool>();
 }
 
 // Load application resources
 void HelloIndexBuffers::LoadResource()
 {
+	// -- Open Pipeline State Cache -- //
+
+	// psos compiled by previous runs are loaded from here instead of being compiled again
+	m_pipelineCache = PipelineStateCache::Open(m_device.Get(), L"PipelineCache.bin");
+
 	// -- Create Root Signature -- //
 
 	{
+		// the scene constants are bound through a per frame descriptor table holding one cbv,
+		// the vertex shader reads them from the frame allocator through it
+		CD3DX12_DESCRIPTOR_RANGE ranges[1];
+		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+
+		CD3DX12_ROOT_PARAMETER rootParameters[1];
+		rootParameters[0].InitAsDescriptorTable(_countof(ranges), ranges, D3D12_SHADER_VISIBILITY_VERTEX);
+
 		CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-		rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+		rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 		ComPtr<ID3DBlob> signature;
 		ComPtr<ID3DBlob> error;
 		ThrowIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
 		ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
+
+		// the pso cache identifies root signatures by their serialized contents
+		m_pipelineCache->RegisterRootSignature(m_rootSignature.Get(), signature->GetBufferPointer(), signature->GetBufferSize());
 	}
 
 	// -- Create Pipeline State -- //
 	// which includes compiling and loading shaders
 
+	// Shader compilation and pso creation run on the worker threads while the rest of
+	// the setup below is recorded. The pso is only joined on right before the setup
+	// commands are submitted, so everything the jobs read has to live until then.
+
+#if defined(_DEBUG)
+	// shaders compiled at runtime are cached by the hash of their preprocessed source
+	m_shaderCache = make_unique<ShaderCache>(L"ShaderCache");
+#endif
+
+	PipelineCompiler pipelineCompiler(*m_threadPool, m_device.Get(), m_pipelineCache.get(), m_shaderCache.get());
+	PipelineCompiler::ShaderFuture vertexShader; // bytecode of the vertex shader, once compiled
+	PipelineCompiler::ShaderFuture pixelShader; // same as VS but for pixel shader
+
+#if defined(_DEBUG)
+	// Enable better shader debugging with the graphics debugging tools
+    // when debugging, we can compile the shader files at runtime.
+	UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+
+	// compile vertex and pixel shaders in parallel, unless the same source was already compiled by an earlier run
+	vertexShader = pipelineCompiler.CompileShaderAsync(L"shaders.hlsl", "VSMain", "vs_5_0", compileFlags);
+	pixelShader = pipelineCompiler.CompileShaderAsync(L"shaders.hlsl", "PSMain", "ps_5_0", compileFlags);
+#else
+	// For release builds the hlsl shaders are compiled by the build with dxc.exe
+	// into .cso files, optimized and with debug and reflection data stripped. The
+	// files are mapped and their contents handed straight to the pso, so there is
+	// no compilation and no copy at runtime. The mappings only need to stay alive
+	// until the pso has been created.
+	MappedFile vertexShaderFile;
+	MappedFile pixelShaderFile;
+	D3D12_SHADER_BYTECODE vertexShaderBytecode = {};
+	D3D12_SHADER_BYTECODE pixelShaderBytecode = {};
+
+	// The .cso files are DXIL, which needs shader model 6.0. The device is only required
+	// to support feature level 11_0, and runtimes that predate shader model 6 fail the query,
+	// so without it the shaders are compiled at runtime into DXBC instead, optimized.
+	D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_0 };
+	if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel))) && shaderModel.HighestShaderModel >= D3D_SHADER_MODEL_6_0)
+	{
+		vertexShaderBytecode = LoadShaderBytecode(vertexShaderFile, L"shaders_VSMain.cso");
+		pixelShaderBytecode = LoadShaderBytecode(pixelShaderFile, L"shaders_PSMain.cso");
+	}
+	else
+	{
+		vertexShader = pipelineCompiler.CompileShaderAsync(L"shaders.hlsl", "VSMain", "vs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3);
+		pixelShader = pipelineCompiler.CompileShaderAsync(L"shaders.hlsl", "PSMain", "ps_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3);
+	}
+#endif
+
+	// -- Prepare Geometry -- //
+
+	// The quad is imported once into a mesh file that stores it the way the gpu reads it. Later
+	// runs map the file and upload straight from the mapping, only a missing or stale file is
+	// imported again. Either way this runs while the shaders compile.
+	const UINT64 meshSourceHash = HashMeshSource();
+	MeshFile meshFile;
+	if (!meshFile.Open(L"Quad.mesh", meshSourceHash))
 	{
-		// create vertex and pixel shaders
-		ComPtr<ID3DBlob> vertexShader; // d3d blob for holding vertex shader bytecode
-		ComPtr<ID3DBlob> pixelShader; // d3d blob for holding pixel shader bytecode
+		vector<UINT8> meshData = ImportMesh(meshSourceHash);
+
+		// failing to write the file only means the quad is imported again next time
+		WriteFileAtomic(L"Quad.mesh", meshData.data(), meshData.size());
+		if (!meshFile.Open(move(meshData), meshSourceHash))
+		{
+			throw HrException(E_FAIL);
+		}
+	}
 
-		// Enable better shader debugging with the graphics debugging tools
-	    // when debugging, we can compile the shader files at runtime.
-		// but for release versions, we can compile the hlsl shaders
-		// with fxc.exe to create .cso files, which contain the shader
-		// bytecode. We can load the .cso files at runtime to get the
-		// shader bytecode, which of course is faster than compiling
-		// them at runtime
-		UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+	const MeshFileHeader& meshHeader = meshFile.GetHeader();
+	const bool strips = (meshHeader.flags & MeshFileFlagStrips) != 0;
+	m_indexChunks.assign(meshFile.GetChunks(), meshFile.GetChunks() + meshHeader.chunkCount);
+	m_primitiveTopology = strips ? D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
-		// compile vertex and pixel shaders
-		ThrowIfFailed(D3DCompileFromFile(L"shaders.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-		ThrowIfFailed(D3DCompileFromFile(L"shaders.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+	// the vertex shader maps the quantized positions back to the bounds of the mesh with these
+	memcpy(&m_constantBufferData.positionScale, meshHeader.positionScale, sizeof(m_constantBufferData.positionScale));
+	memcpy(&m_constantBufferData.positionBias, meshHeader.positionBias, sizeof(m_constantBufferData.positionBias));
 
-		// create input layout
-		// The input layout is used by the Input Assembler so that it knows
-		// how to read the vertex data bound to it.
-		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
+	// Pack the same draws PopulateWorkerCommandList() would record one by one into the
+	// arguments of a single ExecuteIndirect. They are copied to the gpu every frame.
+	if (m_indirect)
+	{
+		for (UINT i = 0; i < m_drawCount; i++)
 		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
-
-		// describe a graphics pipeline state object (PSO).
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };  // the structure describing our input layout
-		psoDesc.pRootSignature = m_rootSignature.Get(); // the root signature that describes the input data this pso needs
-		psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get()); // structure describing where to find the vertex shader bytecode and how large it is
-		psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get()); // same as VS but for pixel shader
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT); // a default rasterizer state
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT); // a default blent state
-		psoDesc.SampleMask = UINT_MAX; // sample mask has to do with multi-sampling. 0xffffffff means point sampling is done
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // type of topology we are drawing
-		psoDesc.NumRenderTargets = 1; // we are only binding one render target
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; // format of the render target
-		psoDesc.SampleDesc.Count = 1; // multisample count (no multisampling, so we just put 1, since we still need 1 sample)
-
-		// create the pso
-		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+			for (const IndexBufferBuilder::Chunk& chunk : m_indexChunks)
+			{
+				const UINT drawCount = m_instancing ? 1 : m_instanceCount;
+				for (UINT draw = 0; draw < drawCount; draw++)
+				{
+					const D3D12_DRAW_INDEXED_ARGUMENTS arguments = { chunk.indexCount, m_instancing ? m_instanceCount : 1, chunk.startIndex, chunk.baseVertex, m_instancing ? 0 : draw };
+					m_indirectArguments.AddDraw(arguments);
+				}
+			}
+		}
+		m_commandSignature = m_indirectArguments.CreateCommandSignature(m_device.Get(), m_rootSignature.Get());
 	}
 
+	// describe a graphics pipeline state object (PSO).
+	// The input layout is used by the Input Assembler so that it knows how to read the vertex
+	// data bound to it, which is stored as PackedVertex: snorm16 positions and unorm8 colors.
+	// The quads' transforms and colors are a second vertex buffer stepped per instance.
+	const D3D12_INPUT_LAYOUT_DESC vertexInputLayout = VertexPacker::GetInputLayout();
+	m_inputElementDescs.assign(vertexInputLayout.pInputElementDescs, vertexInputLayout.pInputElementDescs + vertexInputLayout.NumElements);
+	m_inputElementDescs.insert(m_inputElementDescs.end(), begin(InstanceInputElementDescs), end(InstanceInputElementDescs));
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.InputLayout = { m_inputElementDescs.data(), static_cast<UINT>(m_inputElementDescs.size()) };  // the structure describing our input layout
+	psoDesc.pRootSignature = m_rootSignature.Get(); // the root signature that describes the input data this pso needs
+#if !defined(_DEBUG)
+	psoDesc.VS = vertexShaderBytecode; // structure describing where to find the vertex shader bytecode and how large it is, empty when compiled at runtime
+	psoDesc.PS = pixelShaderBytecode; // same as VS but for pixel shader
+#endif
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT); // a default rasterizer state
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT); // a default blent state
+	psoDesc.SampleMask = UINT_MAX; // sample mask has to do with multi-sampling. 0xffffffff means point sampling is done
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // type of topology we are drawing, covers lists and strips
+	psoDesc.IBStripCutValue = !strips ? D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED // index that restarts the strip
+		: meshHeader.indexSize == sizeof(UINT16) ? D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF : D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF;
+	psoDesc.NumRenderTargets = 1; // we are only binding one render target
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; // format of the render target
+	psoDesc.SampleDesc.Count = 1; // multisample count (no multisampling, so we just put 1, since we still need 1 sample)
+
+	// create the pso once its shaders are compiled, or load it from the cache if a previous run already compiled it
+	PipelineCompiler::PipelineFuture pipelineState = pipelineCompiler.CreateGraphicsPipelineAsync(psoDesc, vertexShader, pixelShader);
+
 	// -- Create Command List -- //
 
-	// create a command list with the first allocator
-	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
+	// nothing has been submitted yet, so there is nothing to wait for
+	m_commandAllocator = m_commandAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, 0);
+
+	// The lists of the recording threads and the list that ends the frame have nothing to record
+	// yet, so they are closed right away. Only one list can record into an allocator at a time.
+	for (UINT t = 0; t < RecordingThreadCount; t++)
+	{
+		ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_workerCommandLists[t])));
+		ThrowIfFailed(m_workerCommandLists[t]->Close());
+	}
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_postCommandList)));
+	ThrowIfFailed(m_postCommandList->Close());
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_barrierCommandList)));
+	ThrowIfFailed(m_barrierCommandList->Close());
 
-	// Command lists are created in the recording state, but there is nothing
-	// to record yet. The main loop expects it to be closed, so close it now.
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
 	ThrowIfFailed(m_commandList->Close());
 
-	// -- Create Vertex Buffer -- //
+	// nothing was recorded into the allocator, so it can be handed out again right away
+	m_commandAllocatorPool->Release(D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), 0, 0);
+	m_commandAllocator.Reset();
 
+	// Create synchronization objects
 	{
-		// triangle vertices with color
-		Vertex triangleVertices[] =
+		ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+		m_fenceValues[m_frameIndex]++;
+
+		// Create an event handle to use for frame synchronization.
+		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (m_fenceEvent == nullptr)
 		{
-			{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
-			{ { 0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f  } },
-			{ { -0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
-			{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } }
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+	}
+
+	// -- Create Copy Queue -- //
 
-		};
+	// Buffer uploads are staged in one persistently mapped ring and copied on their own queue
+	// with its own fence, so they never hold up the frames submitted to m_commandQueue.
+	m_copyQueue = make_unique<CopyQueue>(m_device.Get(), m_commandAllocatorPool.get(), UploadRingSize);
 
-		const UINT vertexBufferSize = sizeof(triangleVertices);
+	// -- Create Frame Allocator -- //
+
+	// every frame also copies the instance data and the indirect arguments into it
+	m_frameAllocator = make_unique<FrameLinearAllocator>(m_device.Get(), FrameCount, FrameAllocatorSize + m_instanceCount * sizeof(Instance) + m_indirectArguments.GetDataSize());
+
+	// -- Create Shader Visible Descriptor Ring -- //
+
+	// per frame descriptor tables are carved out of this heap and given back once the fence passes the frame
+	m_descriptorRing = make_unique<DescriptorRingBuffer>(m_device.Get(), m_fence.Get(), DescriptorRingSize);
+
+	// -- Create Vertex Buffer -- //
+
+	{
+		const UINT vertexBufferSize = static_cast<UINT>(meshFile.GetStreamSize(0));
 
 		// create default heap to hold vertex buffer
-		// Note: using upload heaps to transfer static data like vert buffers is not 
-		// recommended. Every time the GPU needs it, the upload heap will be marshalled 
-		// over. Please read up on Default Heap usage. An upload heap is used here for 
-		// code simplicity and because there are very few verts to actually transfer.
+		// the default heap lives in gpu memory, so the cpu cannot write into it directly.
+		// the data is copied into the upload ring and from there into the vertex buffer,
+		// in several pieces when the buffer is larger than the ring.
 		ThrowIfFailed(m_device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 			D3D12_HEAP_FLAG_NONE,
 			&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
+			D3D12_RESOURCE_STATE_COMMON, // the copy queue can only write buffers in the common state
 			nullptr,
 			IID_PPV_ARGS(&m_vertexBuffer)));
+		ResourceStateTracker::AddGlobalResourceState(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON);
 
-		// Copy the triangle data to the vertex buffer.
-		UINT8* pVertexDataBegin;
-		CD3DX12_RANGE readRange(0, 0);		// We do not intend to read from this resource on the CPU.
-		ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-		memcpy(pVertexDataBegin, triangleVertices, sizeof(triangleVertices));
-		m_vertexBuffer->Unmap(0, nullptr);
+		// Copy the triangle data from the mapped mesh file to the vertex buffer. The buffer is
+		// back in the common state after the copy and promoted to a vertex buffer when drawn.
+		m_copyQueue->UploadBuffer(m_vertexBuffer.Get(), meshFile.GetStreamData(0), vertexBufferSize);
 
 		// Initialize the vertex buffer view for the triangle
 		m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress(); // get the GPU memory address to the vertex pointer
-		m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+		m_vertexBufferView.StrideInBytes = meshHeader.streams[0].stride;
 		m_vertexBufferView.SizeInBytes = vertexBufferSize;
 
 		// -- Create Index Buffer -- //
 
-		// a quad (two triangles)
-		DWORD quadList[] = {
-			0, 1 , 2, // first triangle (left-bottom)
-			0, 3, 1 // second triangle (right-top)
-		};
-
-		const UINT indexBufferSize = sizeof(quadList);
+		const UINT indexBufferSize = static_cast<UINT>(meshFile.GetIndexDataSize());
 
 		// create default heap to hold index buffer
 		ThrowIfFailed(m_device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 			D3D12_HEAP_FLAG_NONE,
 			&CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
+			D3D12_RESOURCE_STATE_COMMON,
 			nullptr,
 			IID_PPV_ARGS(&m_indexBuffer)));
+		ResourceStateTracker::AddGlobalResourceState(m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON);
 
 		// Copy the triangle data to the index buffer.
-		UINT8* pIndexDataBegin;
-		CD3DX12_RANGE readRangex(0, 0);		// We do not intend to read from this resource on the CPU.
-		ThrowIfFailed(m_indexBuffer->Map(0, &readRangex, reinterpret_cast<void**>(&pIndexDataBegin)));
-		memcpy(pIndexDataBegin, quadList, sizeof(quadList));
-		m_indexBuffer->Unmap(0, nullptr);
+		m_copyQueue->UploadBuffer(m_indexBuffer.Get(), meshFile.GetIndexData(), indexBufferSize);
 
 		// Initialize the index buffer view for the triangle
 		m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress(); // get the GPU memory address to the vertex pointer
-		m_indexBufferView.Format = DXGI_FORMAT_R32_UINT; // 32-bit unsigned integer (this is what a dword is, double word, a word is 2 bytes)
+		m_indexBufferView.Format = meshHeader.indexSize == sizeof(UINT16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT; // 16-bit unsigned integer (a word) whenever the chunks allow it
 		m_indexBufferView.SizeInBytes = indexBufferSize;
+
+		// Start both copies now so they run while the psos finish compiling. The first frame
+		// that draws the quad has the direct queue wait for them on the gpu.
+		m_geometryFenceValue = m_copyQueue->Submit();
 	}
 
-	// Create synchronization objects and wait until assets have been uploaded to the GPU.
-	{
-		ThrowIfFailed(m_device->CreateFence(m_fenceValues[m_frameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
-		m_fenceValues[m_frameIndex]++;
+	// -- Wait For Pipeline States -- //
 
-		// Create an event handle to use for frame synchronization.
-		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-		if (m_fenceEvent == nullptr)
-		{
-			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-		}
+	// rethrows anything that went wrong while compiling
+	m_pipelineState = pipelineState.get();
 
-		// Wait for the command list to execute; we are reusing the same command 
-		// list in our main loop but for now, we just want to wait for setup to 
-		// complete before continuing.
-		WaitForGPU();
-	}
+	// nothing has been submitted to the direct queue yet, so the first frame's transient memory is free to use
+	m_frameAllocator->Reset(m_frameIndex);
 }
 
 void HelloIndexBuffers::PopulateCommandList()
 {
+	// The frame is recorded into three groups of lists: m_commandList clears the back
+	// buffer, the worker lists hold the draws and are recorded in parallel, and
+	// m_postCommandList gets the back buffer ready to present. They are executed in that order.
+
 	// Command list allocators can only be reset when the associated 
-	// command lists have finished execution on the GPU; apps should use 
-	// fences to determine GPU execution progress.
-	ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
+	// command lists have finished execution on the GPU; the pool only
+	// hands out allocators whose fence value has been reached.
+	const UINT64 completedFenceValue = m_fence->GetCompletedValue();
+	m_commandAllocator = m_commandAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, completedFenceValue);
+	for (UINT t = 0; t < RecordingThreadCount; t++)
+	{
+		m_workerCommandAllocators[t] = m_commandAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, completedFenceValue);
+	}
+
+	vector<future<void>> workers;
+	workers.reserve(RecordingThreadCount);
+	for (UINT t = 0; t < RecordingThreadCount; t++)
+	{
+		workers.push_back(m_threadPool->Submit([this, t]() { PopulateWorkerCommandList(t); }));
+	}
 
 	// However, when ExecuteCommandList() is called on a particular command 
 	// list, that command list can then be reset at any time and must be before 
 	// re-recording.
-	ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
+	ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get()));
 
-	// Set necessary state.
-	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-	m_commandList->RSSetViewports(1, &m_viewport);
-	m_commandList->RSSetScissorRects(1, &m_scissorRect);
+	// Every command recorded into the allocator is counted, for the pool to see how large it
+	// grows. Each barrier is a command of its own, however many are batched into one call.
+	const UINT64 emittedBarrierCount = m_stateTracker.GetBarriers().GetEmittedCount();
+	m_commandCount = 0;
 
 	// Indicate that the back buffer will be used as a render target.
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-	m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+	m_stateTracker.TransitionResource(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 	// Record commands.
+	m_stateTracker.FlushResourceBarriers(m_commandList.Get());
 	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-	m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	m_commandList->IASetIndexBuffer(&m_indexBufferView);
-	m_commandList->DrawIndexedInstanced(6, 1, 0, 0, 0); // draw 2 triangles (draw 1 instance of 2 triangles)
+	m_commandList->ClearRenderTargetView(m_rtvDescriptors[m_frameIndex].cpuHandle, clearColor, 0, nullptr);
+	m_commandCount++;
+
+	ThrowIfFailed(m_commandList->Close());
+
+	// both lists share the allocator, which is fine as long as only one of them is recording
+	ThrowIfFailed(m_postCommandList->Reset(m_commandAllocator.Get(), nullptr));
 
 	// Indicate that the back buffer will now be used to present.
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	m_stateTracker.TransitionResource(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT);
+	m_stateTracker.FlushResourceBarriers(m_postCommandList.Get());
 
-	ThrowIfFailed(m_commandList->Close());
+	ThrowIfFailed(m_postCommandList->Close());
+	m_commandCount += m_stateTracker.GetBarriers().GetEmittedCount() - emittedBarrierCount;
+
+	// wait for the recording threads, rethrowing anything that failed on them
+	for (future<void>& worker : workers)
+	{
+		worker.get();
+	}
+}
+
+// Record this thread's share of the draws. Runs on the thread pool.
+void HelloIndexBuffers::PopulateWorkerCommandList(UINT threadIndex)
+{
+	ID3D12GraphicsCommandList* pCommandList = m_workerCommandLists[threadIndex].Get();
+
+	// the allocator was already reset by the pool
+	ThrowIfFailed(pCommandList->Reset(m_workerCommandAllocators[threadIndex].Get(), m_pipelineState.Get()));
+
+	// every command recorded below is counted, the pool sees how large the allocator grows from it
+	UINT64& commandCount = m_workerCommandCounts[threadIndex];
+	commandCount = 0;
+
+	// State isn't inherited between command lists, so every list sets up everything it needs.
+	// The frame's descriptor tables all live in the one shader visible heap, it is bound before the tables.
+	ID3D12DescriptorHeap* ppHeaps[] = { m_descriptorRing->GetHeap() };
+	pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	commandCount++;
+
+	pCommandList->SetGraphicsRootSignature(m_rootSignature.Get());
+	commandCount++;
+	pCommandList->SetGraphicsRootDescriptorTable(0, m_sceneDescriptorTable);
+	commandCount++;
+	pCommandList->RSSetViewports(1, &m_viewport);
+	commandCount++;
+	pCommandList->RSSetScissorRects(1, &m_scissorRect);
+	commandCount++;
+
+	pCommandList->OMSetRenderTargets(1, &m_rtvDescriptors[m_frameIndex].cpuHandle, FALSE, nullptr);
+	commandCount++;
+
+	pCommandList->IASetPrimitiveTopology(m_primitiveTopology);
+	commandCount++;
+	const D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[] = { m_vertexBufferView, m_instanceBufferView };
+	pCommandList->IASetVertexBuffers(0, _countof(vertexBufferViews), vertexBufferViews);
+	commandCount++;
+	pCommandList->IASetIndexBuffer(&m_indexBufferView);
+	commandCount++;
+
+	if (m_indirect)
+	{
+		// the draw arguments were packed up front, the whole set is one call on the first thread
+		if (threadIndex == 0)
+		{
+			pCommandList->ExecuteIndirect(m_commandSignature.Get(), m_indirectArguments.GetCommandCount(), m_indirectArgumentAllocation.pResource, m_indirectArgumentAllocation.offset, nullptr, 0);
+			commandCount++;
+		}
+
+		ThrowIfFailed(pCommandList->Close());
+		return;
+	}
+
+	// an even share of the draws, some threads get one more when they don't divide evenly
+	const UINT firstDraw = m_drawCount * threadIndex / RecordingThreadCount;
+	const UINT lastDraw = m_drawCount * (threadIndex + 1) / RecordingThreadCount;
+	for (UINT i = firstDraw; i < lastDraw; i++)
+	{
+		// one draw per index chunk, the quad itself is a single chunk of 2 triangles in one strip
+		for (const IndexBufferBuilder::Chunk& chunk : m_indexChunks)
+		{
+			if (m_instancing)
+			{
+				// all quads at once, the input assembler steps through the instance slot
+				pCommandList->DrawIndexedInstanced(chunk.indexCount, m_instanceCount, chunk.startIndex, chunk.baseVertex, 0);
+				commandCount++;
+			}
+			else
+			{
+				for (UINT instance = 0; instance < m_instanceCount; instance++)
+				{
+					pCommandList->DrawIndexedInstanced(chunk.indexCount, 1, chunk.startIndex, chunk.baseVertex, instance);
+					commandCount++;
+				}
+			}
+		}
+	}
+
+	ThrowIfFailed(pCommandList->Close());
+}
+
+// Record the barriers that take the resources from the states earlier submissions left them in
+// to the states the main thread's lists expect. Call with the state tracker locked, right before
+// executing those lists. Returns false when no barriers were needed.
+bool HelloIndexBuffers::PopulateBarrierCommandList()
+{
+	// every other list recorded into the allocator is closed by now
+	ThrowIfFailed(m_barrierCommandList->Reset(m_commandAllocator.Get(), nullptr));
+	const UINT barrierCount = m_stateTracker.FlushPendingResourceBarriers(m_barrierCommandList.Get());
+	ThrowIfFailed(m_barrierCommandList->Close());
+	m_commandCount += barrierCount;
+	return barrierCount > 0;
+}
+
+// Set up the software rasterizer with the same state the pso and command list use
+void HelloIndexBuffers::LoadSoftwarePipeline()
+{
+	// matches the input layout: POSITION at offset 0 and COLOR at offset 12
+	HeadlessRenderer::Desc desc = {};
+	desc.width = m_width;
+	desc.height = m_height;
+	desc.inputLayout.strideInBytes = sizeof(Vertex);
+	desc.inputLayout.positionOffset = offsetof(Vertex, position);
+	desc.inputLayout.colorOffset = offsetof(Vertex, color);
+	desc.inputLayout.instanceStrideInBytes = sizeof(Instance);
+	desc.inputLayout.instanceTransformOffset = offsetof(Instance, transform);
+	desc.inputLayout.instanceColorOffset = offsetof(Instance, color);
+	desc.pVertices = QuadVertices;
+	desc.vertexCount = _countof(QuadVertices);
+	desc.pIndices = QuadIndices;
+	desc.indexCount = _countof(QuadIndices);
+	desc.pInstances = m_instances.data();
+	desc.instanceCount = m_instanceCount;
+
+	// there is nothing to upload, the renderer optimizes the quad and reads it in place
+	m_headlessRenderer = make_unique<HeadlessRenderer>(desc);
+	m_inputCacheStatistics = m_headlessRenderer->GetInputStatistics();
+	m_outputCacheStatistics = m_headlessRenderer->GetOutputStatistics();
+}
+
+// Lays the quads out in a grid over the viewport, a single quad keeps the size and color it was authored with
+void HelloIndexBuffers::CreateInstances()
+{
+	m_instances = CreateQuadInstances(m_instanceCount);
+}
+
+// Runs the whole import of the quad and lays the result out as a mesh file
+vector<UINT8> HelloIndexBuffers::ImportMesh(UINT64 sourceHash)
+{
+	// Reorder the triangles for the post-transform cache and the vertices for fetch locality.
+	vector<Vertex> optimizedVertices;
+	vector<uint32_t> optimizedIndices;
+	OptimizeMesh(optimizedVertices, optimizedIndices);
+
+	// Cluster the optimized mesh into meshlets and report them. Nothing draws them yet, so they
+	// are not stored in the mesh file. A real scene passes all its meshes at once.
+	MeshletBuilder::Mesh meshletInput = { optimizedVertices.data(), static_cast<UINT>(optimizedVertices.size()), sizeof(Vertex), offsetof(Vertex, position), optimizedIndices.data(), static_cast<UINT>(optimizedIndices.size()) };
+	const MeshletBuilder::Meshlets meshlets = move(MeshletBuilder::Build(*m_threadPool, { meshletInput }).front());
+
+	WCHAR message[256];
+	swprintf_s(message, L"%ls: %u meshlets, %u vertices and %u triangles\n",
+		m_title.c_str(), meshlets.GetCount(), static_cast<UINT>(meshlets.vertexIndices.size()), static_cast<UINT>(meshlets.triangleIndices.size() / 3));
+	OutputDebugStringW(message);
+
+	// Pick 16-bit indices when the mesh allows it. Meshes with more vertices than 16 bits can
+	// address are split into chunks drawn with a base vertex, which may reorder the vertices.
+	IndexBufferBuilder indexBuilder(optimizedIndices.data(), static_cast<uint32_t>(optimizedIndices.size()), static_cast<uint32_t>(optimizedVertices.size()));
+	vector<Vertex> vertices(indexBuilder.GetVertexCount());
+	indexBuilder.RemapVertices(optimizedVertices.data(), sizeof(Vertex), vertices.data());
+
+	// Draw triangle strips cut by restart indices when they take fewer indices than the list.
+	// The pso's strip cut value has to match the index format.
+	indexBuilder.BuildStrips();
+
+	swprintf_s(message, L"%ls: %u indices as a triangle list, %u as drawn\n",
+		m_title.c_str(), static_cast<UINT>(optimizedIndices.size()), indexBuilder.GetIndexDataSize() / indexBuilder.GetIndexSize());
+	OutputDebugStringW(message);
+
+	// Quantize the vertices to 12 bytes each. The positions are stored relative to the bounds
+	// of the mesh, the vertex shader scales and biases them back with the header's constants.
+	VertexPacker vertexPacker(vertices.data(), static_cast<UINT>(vertices.size()), sizeof(Vertex), offsetof(Vertex, position), offsetof(Vertex, color));
+	vector<PackedVertex> packedVertices(vertexPacker.GetVertexCount());
+	vertexPacker.Pack(packedVertices.data());
+	vertexPacker.CheckError(packedVertices.data());
+
+	MeshFile::Desc desc = {};
+	desc.sourceHash = sourceHash;
+	desc.vertexCount = vertexPacker.GetVertexCount();
+	desc.streamCount = 1;
+	desc.pStreamData[0] = packedVertices.data();
+	desc.streamStrides[0] = sizeof(PackedVertex);
+	desc.pIndexData = indexBuilder.GetIndexData();
+	desc.indexCount = indexBuilder.GetIndexDataSize() / indexBuilder.GetIndexSize();
+	desc.indexSize = indexBuilder.GetIndexSize();
+	desc.pChunks = indexBuilder.GetChunks().data();
+	desc.chunkCount = static_cast<UINT>(indexBuilder.GetChunks().size());
+	desc.flags = indexBuilder.UsesStrips() ? MeshFileFlagStrips : 0;
+	for (UINT axis = 0; axis < 3; axis++)
+	{
+		// the snorm range [-1, 1] covers exactly the bounds
+		desc.boundsMin[axis] = vertexPacker.GetPositionBias()[axis] - vertexPacker.GetPositionScale()[axis];
+		desc.boundsMax[axis] = vertexPacker.GetPositionBias()[axis] + vertexPacker.GetPositionScale()[axis];
+	}
+	memcpy(desc.positionScale, vertexPacker.GetPositionScale(), sizeof(desc.positionScale));
+	memcpy(desc.positionBias, vertexPacker.GetPositionBias(), sizeof(desc.positionBias));
+
+	return MeshFile::Serialize(desc);
+}
+
+// Hashes everything the mesh file depends on, so it is imported again when any of it changes
+UINT64 HelloIndexBuffers::HashMeshSource()
+{
+	Hasher hasher;
+	hasher.Add(QuadVertices, sizeof(QuadVertices));
+	hasher.Add(QuadIndices, sizeof(QuadIndices));
+	hasher.AddValue(sizeof(PackedVertex));
+	hasher.AddValue(IndexBufferBuilder::MaxChunkVertexCount);
+	return hasher.GetValue();
+}
+
+// Runs the import time optimizations over the quad and reports how much vertex shader work they saved
+void HelloIndexBuffers::OptimizeMesh(vector<Vertex>& vertices, vector<uint32_t>& indices)
+{
+	MeshOptimizer meshOptimizer(QuadIndices, _countof(QuadIndices), _countof(QuadVertices));
+	vertices.resize(meshOptimizer.GetVertexCount());
+	meshOptimizer.RemapVertices(QuadVertices, sizeof(Vertex), vertices.data());
+	indices = meshOptimizer.GetIndices();
+
+	// kept for RunHeadless(), which prints them next to the frame times
+	m_inputCacheStatistics = meshOptimizer.GetInputStatistics();
+	m_outputCacheStatistics = meshOptimizer.GetOutputStatistics();
+
+	WCHAR message[256];
+	swprintf_s(message, L"%ls: vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		m_title.c_str(), m_inputCacheStatistics.acmr, m_outputCacheStatistics.acmr, m_inputCacheStatistics.atvr, m_outputCacheStatistics.atvr);
+	OutputDebugStringW(message);
 }
 
 void HelloIndexBuffers::WaitForGPU()
@@ -368,8 +976,8 @@ void HelloIndexBuffers::MoveToNextFrame()
 	const UINT64 fence = m_fenceValues[m_frameIndex];
 	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fence));
 
-	// Update the frame index
-	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+	// Update the frame index. Without presents the swap chain never moves on, so the back buffers are cycled here.
+	m_frameIndex = m_presentMode == PresentModeNone ? (m_frameIndex + 1) % FrameCount : m_swapChain->GetCurrentBackBufferIndex();
 
 	// Wait until the previous frame is finished.
 	if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
@@ -380,6 +988,9 @@ void HelloIndexBuffers::MoveToNextFrame()
 
 	// Set the fence value for the next frame
 	m_fenceValues[m_frameIndex] = fence + 1;
+
+	// The gpu is done with the last frame that used this back buffer, so its transient memory can be reused.
+	m_frameAllocator->Reset(m_frameIndex);
 }
 
 // Get the first available hardware adapter that supports Direct3D 12
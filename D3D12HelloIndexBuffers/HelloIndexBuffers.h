@@ -2,6 +2,25 @@
 
 #include "DXSampleHelper.h"
 #include "Win32Application.h"
+#include "HeadlessRenderer.h"
+#include "QuadMesh.h"
+#include "CommandAllocatorPool.h"
+#include "CopyQueue.h"
+#include "DescriptorHeapAllocator.h"
+#include "DescriptorRingBuffer.h"
+#include "FrameLinearAllocator.h"
+#include "FramePacer.h"
+#include "IndexBufferBuilder.h"
+#include "IndirectArgumentBuilder.h"
+#include "MeshFile.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "PipelineCompiler.h"
+#include "PipelineStateCache.h"
+#include "ResourceStateTracker.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+#include "VertexPacker.h"
 
 using namespace std;
 using namespace DirectX;
@@ -24,10 +43,19 @@ public:
 	void OnRender();
 	void OnDestroy();
 
+	void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
+
 	// Accessors
 	UINT GetWidth() const { return m_width; }
 	UINT GetHeight() const { return m_height; }
 	const WCHAR* GetTitle() const { return m_title.c_str(); }
+	bool IsOccluded(); // the last present found the window hidden, and it still is
+	bool IsHeadless() const { return m_headless; }
+	UINT GetHeadlessFrameCount() const { return m_headlessFrameCount; }
+	const MeshOptimizer::CacheStatistics& GetInputCacheStatistics() const { return m_inputCacheStatistics; } // of the quad as authored
+	const MeshOptimizer::CacheStatistics& GetOutputCacheStatistics() const { return m_outputCacheStatistics; } // after the import time optimization
+	HANDLE GetFrameLatencyWaitableObject() const { return m_framePacer && m_presentMode != PresentModeNone ? m_framePacer->GetWaitableObject() : nullptr; } // null when nothing is presented
+	double GetAverageLatency() const { return m_framePacer ? m_framePacer->GetAverageLatency() : 0.0; } // milliseconds from sampling a frame's input to its vblank
 
 protected:
 	void GetHardwareAdapter(_In_ IDXGIFactory2* pFactory, _Outptr_result_maybenull_ IDXGIAdapter1** ppAdapter);
@@ -37,16 +65,50 @@ protected:
 	UINT m_height; // window height
 
 	wstring m_title; // window title
+	bool m_occluded; // nothing of the window was visible on the last present
+
+	// how frames are handed to the display, picked with -present
+	enum PresentMode
+	{
+		PresentModeVSync, // wait for the vblank, the frame rate is capped at the refresh rate
+		PresentModeMailbox, // don't wait, the newest frame replaces any queued one at the vblank so nothing tears
+		PresentModeTearing, // don't wait and show the frame right away, even halfway through scanout
+		PresentModeNone, // render without ever presenting, to measure what rendering alone costs
+	};
+
+	bool m_headless; // render with the software rasterizer into an offscreen target, no window or d3d12 device is created
+	UINT m_headlessFrameCount; // number of frames the headless loop renders before exiting
+	UINT m_drawCount; // number of times the quad is drawn each frame, split across the recording threads
+	UINT m_instanceCount; // number of quads each draw covers, laid out in a grid
+	bool m_instancing; // one instanced draw for all quads, or one draw per quad for comparison
+	bool m_indirect; // submit all draws of a frame with one ExecuteIndirect instead of recording them
+	UINT m_maxFrameLatency; // frames the swap chain may queue before the next one has to wait
+	bool m_justInTime; // delay each frame's start so its cpu work ends right before the swap chain takes it
+	PresentMode m_presentMode;
 
 private:
 	static const UINT FrameCount = 3; // number of buffers we want, 2 for double buffering, 3 for tripple buffering
+	static const UINT RecordingThreadCount = 4; // number of threads the draws of a frame are recorded on
+	static const UINT64 UploadRingSize = 4 * 1024 * 1024; // size of the staging memory of the copy queue
+	static const UINT64 FrameAllocatorSize = 1024 * 1024; // transient memory each frame can allocate constants and dynamic geometry from
+	static const UINT RtvDescriptorCount = 64; // render target views per cpu only heap
+	static const UINT DescriptorRingSize = 64 * 1024; // shader visible descriptors shared by the per frame tables of all frames in flight
 
-	// vertex structure
-	struct Vertex
+	// vertex structure, as authored. the gpu gets it as PackedVertex
+	typedef QuadVertex Vertex;
+
+	// per instance data of the second input slot, matches InstanceInputElementDescs
+	typedef QuadInstance Instance;
+
+	// per frame constants, matches SceneConstantBuffer in shaders.hlsl
+	struct SceneConstantBuffer
 	{
-		XMFLOAT3 position;
-		XMFLOAT4 color;
-	};  
+		XMFLOAT4 offset;
+		XMFLOAT4 positionScale; // maps the snorm16 positions back to the mesh's range
+		XMFLOAT4 positionBias;
+		float padding[52]; // a constant buffer view covers a multiple of 256 bytes
+	};
+	static_assert((sizeof(SceneConstantBuffer) % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT) == 0, "Constant Buffer size must be 256-byte aligned");
 
 	// Graphics Pipeline objects
 	CD3DX12_VIEWPORT m_viewport; // area that output from rasterizer will be stretched to
@@ -54,21 +116,46 @@ private:
 	ComPtr<IDXGISwapChain3> m_swapChain; // swapchain used to switch between render targets
 	ComPtr<ID3D12Device> m_device; // direct3d device
 	ComPtr<ID3D12Resource> m_renderTargets[FrameCount]; // number of render targets equal to buffer count
-	ComPtr<ID3D12CommandAllocator> m_commandAllocators[FrameCount]; // we want enough allocators for each buffer * number of threads (we only have one thread)
+	unique_ptr<CommandAllocatorPool> m_commandAllocatorPool; // recycles allocators once the gpu is done with them
+	ComPtr<ID3D12CommandAllocator> m_commandAllocator; // allocator of the main thread's lists while they are recorded
+	UINT64 m_commandCount; // commands recorded into m_commandAllocator this frame, by all the main thread's lists
+	ComPtr<ID3D12CommandAllocator> m_workerCommandAllocators[RecordingThreadCount]; // each recording thread needs its own allocator
+	UINT64 m_workerCommandCounts[RecordingThreadCount]; // commands each recording thread recorded this frame
 	ComPtr<ID3D12CommandQueue> m_commandQueue; // container for command lists
 	ComPtr<ID3D12RootSignature> m_rootSignature; // root signature defines data shaders will access
-	ComPtr<ID3D12DescriptorHeap> m_rtvDescriptorHeap; // a descriptor heap to hold resources like the render targets
+	unique_ptr<DescriptorHeapAllocator> m_rtvAllocator; // hands out descriptors for render target views
+	DescriptorHeapAllocator::Allocation m_rtvDescriptors[FrameCount]; // the view of each back buffer
+	unique_ptr<DescriptorRingBuffer> m_descriptorRing; // the shader visible heap, per frame descriptor tables are allocated from it
 	ComPtr<ID3D12PipelineState> m_pipelineState; // pso containing a pipeline state
+	unique_ptr<PipelineStateCache> m_pipelineCache; // compiled psos persisted between runs
+	unique_ptr<ShaderCache> m_shaderCache; // bytecode of shaders compiled at runtime, persisted between runs
+	unique_ptr<ThreadPool> m_threadPool; // worker threads for startup compilation and command list recording
 	ComPtr<ID3D12GraphicsCommandList> m_commandList; // a command list we can record commands into, then execute them to render the frame
-	UINT m_rtvDescriptorSize; // size of the rtv descriptor on the device (all front and back buffers will be the same size) function declarations
+	ComPtr<ID3D12GraphicsCommandList> m_workerCommandLists[RecordingThreadCount]; // the draws, one list per recording thread
+	ComPtr<ID3D12GraphicsCommandList> m_postCommandList; // transitions the back buffer for present after the draws
+	ComPtr<ID3D12GraphicsCommandList> m_barrierCommandList; // barriers resolved on submission, runs before the lists it was resolved for
+	ResourceStateTracker m_stateTracker; // resource states of the lists the main thread records
 
 	// App resources
+	unique_ptr<CopyQueue> m_copyQueue; // uploads buffer data into default heaps alongside rendering
+	UINT64 m_geometryFenceValue; // copy fence value at which the vertex and index buffers are uploaded
+	unique_ptr<FrameLinearAllocator> m_frameAllocator; // transient per frame memory, one slot per back buffer
+	SceneConstantBuffer m_constantBufferData; // constants written for the next frame
+	D3D12_GPU_DESCRIPTOR_HANDLE m_sceneDescriptorTable; // this frame's table in the descriptor ring, a cbv of the constants in the frame allocator
 	ComPtr<ID3D12Resource> m_vertexBuffer; // a default buffer in GPU memory that we will load vertex data for our triangle into
 	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView; // a structure containing a pointer to the vertex data in gpu memory
 										         // the total size of the buffer, and the size of each element (vertex)
 
 	ComPtr<ID3D12Resource> m_indexBuffer; // a default buffer in GPU memory that we will load index data for our triangle into
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView; // a structure holding information about the index buffer
+	vector<Instance> m_instances; // transform and color of every quad, copied into the frame allocator each frame
+	D3D12_VERTEX_BUFFER_VIEW m_instanceBufferView; // this frame's copy of m_instances
+	IndirectArgumentBuilder m_indirectArguments; // every draw of a frame, packed for ExecuteIndirect
+	ComPtr<ID3D12CommandSignature> m_commandSignature; // layout of m_indirectArguments
+	FrameLinearAllocator::Allocation m_indirectArgumentAllocation; // this frame's copy of m_indirectArguments
+	vector<D3D12_INPUT_ELEMENT_DESC> m_inputElementDescs; // the vertex and the instance slot, referenced by the pso description
+	D3D_PRIMITIVE_TOPOLOGY m_primitiveTopology; // triangle strips when they make the index buffer smaller, a list otherwise
+	vector<IndexBufferBuilder::Chunk> m_indexChunks; // the draws that make up the mesh, more than one when it was split for 16-bit indices
 
 	// Synchronization objects
 	UINT m_frameIndex; // current rtv we are on
@@ -76,10 +163,23 @@ private:
 	ComPtr<ID3D12Fence> m_fence; // an object that is locked while our command list is being executed by the gpu. We need as many 
 							     // as we have allocators (more if we want to know when the gpu is finished with an asset)
 	UINT64 m_fenceValues[FrameCount]; // this values are incremented each frame. each fence will have its own value
+	unique_ptr<FramePacer> m_framePacer; // limits the queued frames and measures their latency
+
+	// Headless rendering
+	unique_ptr<HeadlessRenderer> m_headlessRenderer; // cpu backend used instead of the device when running headless
+	MeshOptimizer::CacheStatistics m_inputCacheStatistics; // vertex cache efficiency before and after OptimizeMesh()
+	MeshOptimizer::CacheStatistics m_outputCacheStatistics;
 
 	void LoadPipeline();
 	void LoadResource();
+	void LoadSoftwarePipeline();
+	void CreateInstances();
+	vector<UINT8> ImportMesh(UINT64 sourceHash);
+	UINT64 HashMeshSource();
+	void OptimizeMesh(vector<Vertex>& vertices, vector<uint32_t>& indices);
 	void PopulateCommandList();
+	void PopulateWorkerCommandList(UINT threadIndex);
+	bool PopulateBarrierCommandList();
 	void MoveToNextFrame();
 	void WaitForGPU();
 };
@@ -0,0 +1,182 @@
+#include "IndexBufferBuilder.h"
+#include "Stripifier.h"
+
+#include <cstring>
+
+IndexBufferBuilder::IndexBufferBuilder(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t maxChunkVertexCount) :
+	m_indexSize(sizeof(uint16_t)),
+	m_strips(false),
+	m_vertexCount(vertexCount)
+{
+	if (vertexCount <= maxChunkVertexCount)
+	{
+		// the common case, the indices are narrowed and nothing else changes
+		m_indices.resize(indexCount * sizeof(uint16_t));
+		uint16_t* pOut = reinterpret_cast<uint16_t*>(m_indices.data());
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			pOut[i] = static_cast<uint16_t>(pIndices[i]);
+		}
+		m_chunks.push_back({ 0, indexCount, 0 });
+		return;
+	}
+
+	if (!BuildChunks(pIndices, indexCount, vertexCount, maxChunkVertexCount))
+	{
+		Build32(pIndices, indexCount);
+	}
+}
+
+void IndexBufferBuilder::Build32(const uint32_t* pIndices, uint32_t indexCount)
+{
+	m_indexSize = sizeof(uint32_t);
+	m_indices.resize(indexCount * sizeof(uint32_t));
+	memcpy(m_indices.data(), pIndices, m_indices.size());
+	m_chunks.assign(1, { 0, indexCount, 0 });
+	m_vertexRemap.clear();
+}
+
+bool IndexBufferBuilder::BuildChunks(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t maxChunkVertexCount)
+{
+	// a triangle needs 3 vertices of its own chunk
+	if (maxChunkVertexCount < 3)
+	{
+		return false;
+	}
+
+	const uint32_t NotInChunk = 0xffffffff;
+	std::vector<uint32_t> localIndices(vertexCount, NotInChunk); // where an input vertex sits in the current chunk
+	std::vector<uint16_t> indices;
+	indices.reserve(indexCount);
+
+	Chunk chunk = { 0, 0, 0 };
+	uint32_t chunkVertexCount = 0;
+
+	for (uint32_t triangle = 0; triangle + 3 <= indexCount; triangle += 3)
+	{
+		// how many vertices the triangle adds to the chunk
+		uint32_t newVertexCount = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = pIndices[triangle + corner];
+			if (vertex >= vertexCount)
+			{
+				return false;
+			}
+			const bool seen = localIndices[vertex] != NotInChunk
+				|| (corner > 0 && vertex == pIndices[triangle])
+				|| (corner > 1 && vertex == pIndices[triangle + 1]);
+			newVertexCount += seen ? 0 : 1;
+		}
+
+		// start the next chunk when this one is full
+		if (chunkVertexCount + newVertexCount > maxChunkVertexCount)
+		{
+			m_chunks.push_back(chunk);
+			for (uint32_t i = chunk.baseVertex; i < m_vertexRemap.size(); i++)
+			{
+				localIndices[m_vertexRemap[i]] = NotInChunk;
+			}
+			chunk.startIndex = static_cast<uint32_t>(indices.size());
+			chunk.indexCount = 0;
+			chunk.baseVertex = static_cast<int32_t>(m_vertexRemap.size());
+			chunkVertexCount = 0;
+		}
+
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = pIndices[triangle + corner];
+			if (localIndices[vertex] == NotInChunk)
+			{
+				localIndices[vertex] = chunkVertexCount++;
+				m_vertexRemap.push_back(vertex);
+			}
+			indices.push_back(static_cast<uint16_t>(localIndices[vertex]));
+		}
+		chunk.indexCount += 3;
+	}
+
+	if (chunk.indexCount > 0)
+	{
+		m_chunks.push_back(chunk);
+	}
+
+	m_indices.resize(indices.size() * sizeof(uint16_t));
+	memcpy(m_indices.data(), indices.data(), m_indices.size());
+	m_vertexCount = static_cast<uint32_t>(m_vertexRemap.size());
+	return true;
+}
+
+bool IndexBufferBuilder::BuildStrips()
+{
+	if (m_strips)
+	{
+		return true;
+	}
+
+	std::vector<uint8_t> indices;
+	std::vector<Chunk> chunks;
+	std::vector<uint32_t> chunkIndices;
+	for (const Chunk& chunk : m_chunks)
+	{
+		// the chunk's own indices, widened for the stripifier
+		chunkIndices.resize(chunk.indexCount);
+		uint32_t vertexCount = 0;
+		for (uint32_t i = 0; i < chunk.indexCount; i++)
+		{
+			const uint8_t* pIndex = m_indices.data() + static_cast<size_t>(chunk.startIndex + i) * m_indexSize;
+			if (Uses16BitIndices())
+			{
+				chunkIndices[i] = *reinterpret_cast<const uint16_t*>(pIndex);
+			}
+			else
+			{
+				chunkIndices[i] = *reinterpret_cast<const uint32_t*>(pIndex);
+			}
+			vertexCount = chunkIndices[i] + 1 > vertexCount ? chunkIndices[i] + 1 : vertexCount;
+		}
+
+		// no chunk vertex is 0xffff, so narrowing only turns the restart index into the 16-bit cut value
+		Stripifier stripifier(chunkIndices.data(), chunk.indexCount, vertexCount);
+		chunks.push_back({ static_cast<uint32_t>(indices.size() / m_indexSize), stripifier.GetIndexCount(), chunk.baseVertex });
+		for (uint32_t index : stripifier.GetIndices())
+		{
+			const size_t offset = indices.size();
+			indices.resize(offset + m_indexSize);
+			if (Uses16BitIndices())
+			{
+				*reinterpret_cast<uint16_t*>(indices.data() + offset) = static_cast<uint16_t>(index);
+			}
+			else
+			{
+				*reinterpret_cast<uint32_t*>(indices.data() + offset) = index;
+			}
+		}
+	}
+
+	if (indices.size() >= m_indices.size())
+	{
+		return false;
+	}
+
+	m_indices.swap(indices);
+	m_chunks.swap(chunks);
+	m_strips = true;
+	return true;
+}
+
+void IndexBufferBuilder::RemapVertices(const void* pSource, uint32_t strideInBytes, void* pDestination) const
+{
+	if (m_vertexRemap.empty())
+	{
+		memcpy(pDestination, pSource, static_cast<size_t>(m_vertexCount) * strideInBytes);
+		return;
+	}
+
+	const uint8_t* pIn = static_cast<const uint8_t*>(pSource);
+	uint8_t* pOut = static_cast<uint8_t*>(pDestination);
+	for (size_t i = 0; i < m_vertexRemap.size(); i++)
+	{
+		memcpy(pOut + i * strideInBytes, pIn + static_cast<size_t>(m_vertexRemap[i]) * strideInBytes, strideInBytes);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Turns a 32-bit triangle list into the smallest index buffer that can draw it.
+// When every vertex fits below MaxChunkVertexCount the indices are simply narrowed to
+// 16 bits. Larger meshes are split into chunks of whole triangles that each reference
+// fewer vertices than that; every chunk gets its own contiguous run of vertices, so it
+// is drawn with 16-bit indices and the run's start as base vertex. Vertices shared by
+// two chunks are duplicated, GetVertexRemap() says which input vertex goes where.
+// Only 32-bit indices are kept when a chunk can't be formed at all.
+//
+// BuildStrips() then optionally turns each chunk into triangle strips with restart indices.
+//
+// Like the software rasterizer this only depends on the C++ standard library.
+class IndexBufferBuilder
+{
+public:
+	// 0xffff is left out, it is the strip cut value of 16-bit index buffers
+	static const uint32_t MaxChunkVertexCount = 0xffff;
+
+	// one DrawIndexedInstanced() worth of the mesh
+	struct Chunk
+	{
+		uint32_t startIndex; // StartIndexLocation
+		uint32_t indexCount; // IndexCountPerInstance
+		int32_t baseVertex; // BaseVertexLocation
+	};
+
+	// maxChunkVertexCount can be lowered to exercise the splitting with small meshes
+	IndexBufferBuilder(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t maxChunkVertexCount = MaxChunkVertexCount);
+
+	// Replaces the triangle list of every chunk with triangle strips joined by GetStripCutValue().
+	// Returns false and keeps the lists when the strips wouldn't be smaller.
+	bool BuildStrips();
+
+	bool Uses16BitIndices() const { return m_indexSize == sizeof(uint16_t); }
+	bool UsesStrips() const { return m_strips; } // draw with D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP
+	uint32_t GetStripCutValue() const { return Uses16BitIndices() ? 0xffff : 0xffffffff; } // the pso's IBStripCutValue
+	uint32_t GetIndexSize() const { return m_indexSize; } // 2 or 4 bytes
+	const void* GetIndexData() const { return m_indices.data(); }
+	uint32_t GetIndexDataSize() const { return static_cast<uint32_t>(m_indices.size()); }
+	const std::vector<Chunk>& GetChunks() const { return m_chunks; }
+
+	// Output vertex i is input vertex GetVertexRemap()[i]. Empty when the
+	// vertices are used as they are.
+	const std::vector<uint32_t>& GetVertexRemap() const { return m_vertexRemap; }
+	uint32_t GetVertexCount() const { return m_vertexCount; } // number of output vertices
+
+	// Copies the input vertices into their output order, pDestination has room for GetVertexCount() vertices.
+	void RemapVertices(const void* pSource, uint32_t strideInBytes, void* pDestination) const;
+
+private:
+	void Build32(const uint32_t* pIndices, uint32_t indexCount);
+	bool BuildChunks(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t maxChunkVertexCount);
+
+	uint32_t m_indexSize;
+	bool m_strips;
+	std::vector<uint8_t> m_indices; // index data in the chosen format
+	std::vector<Chunk> m_chunks;
+	std::vector<uint32_t> m_vertexRemap;
+	uint32_t m_vertexCount;
+};
@@ -0,0 +1,54 @@
+#include "stdafx.h"
+#include "IndirectArgumentBuilder.h"
+
+IndirectArgumentBuilder::IndirectArgumentBuilder(UINT rootConstantCount, UINT rootParameterIndex) :
+	m_rootConstantCount(rootConstantCount),
+	m_byteStride(rootConstantCount * sizeof(UINT) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS)),
+	m_signatureDesc{}
+{
+	// the draw has to be the last argument of a command
+	if (rootConstantCount > 0)
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC constants = {};
+		constants.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+		constants.Constant.RootParameterIndex = rootParameterIndex;
+		constants.Constant.DestOffsetIn32BitValues = 0;
+		constants.Constant.Num32BitValuesToSet = rootConstantCount;
+		m_argumentDescs.push_back(constants);
+	}
+
+	D3D12_INDIRECT_ARGUMENT_DESC draw = {};
+	draw.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+	m_argumentDescs.push_back(draw);
+
+	m_signatureDesc.ByteStride = m_byteStride;
+	m_signatureDesc.NumArgumentDescs = static_cast<UINT>(m_argumentDescs.size());
+	m_signatureDesc.pArgumentDescs = m_argumentDescs.data();
+	m_signatureDesc.NodeMask = 0;
+}
+
+void IndirectArgumentBuilder::AddDraw(const D3D12_DRAW_INDEXED_ARGUMENTS& arguments, const UINT* pRootConstants)
+{
+	if (m_rootConstantCount > 0 && pRootConstants == nullptr)
+	{
+		throw HrException(E_INVALIDARG);
+	}
+
+	const size_t offset = m_data.size();
+	m_data.resize(offset + m_byteStride);
+
+	UINT8* pCommand = m_data.data() + offset;
+	if (m_rootConstantCount > 0)
+	{
+		memcpy(pCommand, pRootConstants, m_rootConstantCount * sizeof(UINT));
+	}
+	memcpy(pCommand + m_rootConstantCount * sizeof(UINT), &arguments, sizeof(arguments));
+}
+
+ComPtr<ID3D12CommandSignature> IndirectArgumentBuilder::CreateCommandSignature(ID3D12Device* pDevice, ID3D12RootSignature* pRootSignature) const
+{
+	// the runtime rejects a root signature when the commands only draw
+	ComPtr<ID3D12CommandSignature> commandSignature;
+	ThrowIfFailed(pDevice->CreateCommandSignature(&m_signatureDesc, m_rootConstantCount > 0 ? pRootSignature : nullptr, IID_PPV_ARGS(&commandSignature)));
+	return commandSignature;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Packs draws into an ExecuteIndirect argument buffer and describes the matching command
+// signature. Every command is the optional 32-bit root constants followed by one
+// D3D12_DRAW_INDEXED_ARGUMENTS, with no padding in between or after, so the byte stride
+// is 4 bytes per root constant plus 20. The layout and the packed bytes don't need a
+// device, only CreateCommandSignature() does.
+class IndirectArgumentBuilder
+{
+public:
+	// Each draw also sets rootConstantCount 32-bit constants of the root parameter
+	// rootParameterIndex, which has to be a D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS.
+	explicit IndirectArgumentBuilder(UINT rootConstantCount = 0, UINT rootParameterIndex = 0);
+
+	// pRootConstants points at GetRootConstantCount() values, or is null when there are none.
+	void AddDraw(const D3D12_DRAW_INDEXED_ARGUMENTS& arguments, const UINT* pRootConstants = nullptr);
+	void Clear() { m_data.clear(); }
+
+	UINT GetCommandCount() const { return static_cast<UINT>(m_data.size() / m_byteStride); }
+	UINT GetByteStride() const { return m_byteStride; }
+	UINT GetRootConstantCount() const { return m_rootConstantCount; }
+	const void* GetData() const { return m_data.data(); }
+	UINT64 GetDataSize() const { return m_data.size(); }
+
+	// points into the builder, stays valid as long as it does
+	const D3D12_COMMAND_SIGNATURE_DESC& GetCommandSignatureDesc() const { return m_signatureDesc; }
+
+	// pRootSignature is only needed, and then required, when the commands set root constants.
+	ComPtr<ID3D12CommandSignature> CreateCommandSignature(ID3D12Device* pDevice, ID3D12RootSignature* pRootSignature) const;
+
+private:
+	IndirectArgumentBuilder(const IndirectArgumentBuilder&) = delete;
+	IndirectArgumentBuilder& operator=(const IndirectArgumentBuilder&) = delete;
+
+	UINT m_rootConstantCount;
+	UINT m_byteStride;
+	std::vector<D3D12_INDIRECT_ARGUMENT_DESC> m_argumentDescs;
+	D3D12_COMMAND_SIGNATURE_DESC m_signatureDesc;
+	std::vector<UINT8> m_data;
+};
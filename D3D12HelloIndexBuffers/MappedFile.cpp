@@ -0,0 +1,96 @@
+#include "stdafx.h"
+#include "MappedFile.h"
+
+#include <string>
+
+MappedFile::MappedFile() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+	m_pData(nullptr),
+	m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(LPCWSTR fileName)
+{
+	Close();
+
+	m_file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// empty files can't be mapped
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_pData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_size = static_cast<SIZE_T>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+bool WriteFileAtomic(LPCWSTR fileName, const void* pData, SIZE_T size)
+{
+	// The thread id keeps two threads writing the same file, like two compiles of the
+	// same shader, from sharing the temporary file.
+	const std::wstring tempFileName = std::wstring(fileName) + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+	HANDLE file = CreateFileW(tempFileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD bytesWritten = 0;
+	const BOOL written = WriteFile(file, pData, static_cast<DWORD>(size), &bytesWritten, nullptr);
+	CloseHandle(file);
+
+	if (!written || bytesWritten != size || !MoveFileExW(tempFileName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tempFileName.c_str());
+		return false;
+	}
+	return true;
+}
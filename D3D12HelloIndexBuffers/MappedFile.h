@@ -0,0 +1,32 @@
+#pragma once
+
+// A read-only view of a whole file mapped into memory. The contents are paged in by the
+// os on first access instead of being read into a heap allocation up front.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the file, returns false if it doesn't exist or is empty.
+	bool Open(LPCWSTR fileName);
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+	const void* GetData() const { return m_pData; }
+	SIZE_T GetSize() const { return m_size; }
+
+private:
+	// a mapping can't be copied, it owns the file and mapping handles
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const void* m_pData;
+	SIZE_T m_size;
+};
+
+// Writes the whole file through a temporary file, so readers see either the old or the new
+// contents but never a partial write. Returns false if the file couldn't be written.
+bool WriteFileAtomic(LPCWSTR fileName, const void* pData, SIZE_T size);
@@ -0,0 +1,155 @@
+#include "stdafx.h"
+#include "MeshFile.h"
+
+namespace
+{
+	UINT64 AlignSection(UINT64 offset)
+	{
+		return (offset + MeshFile::SectionAlignment - 1) & ~static_cast<UINT64>(MeshFile::SectionAlignment - 1);
+	}
+
+	// the section lies inside the file and is aligned
+	bool IsValidSection(UINT64 offset, UINT64 size, UINT64 fileSize)
+	{
+		return offset % MeshFile::SectionAlignment == 0 && offset >= sizeof(MeshFileHeader) && offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+std::vector<UINT8> MeshFile::Serialize(const Desc& desc)
+{
+	if (desc.streamCount > MaxStreamCount || (desc.indexSize != sizeof(UINT16) && desc.indexSize != sizeof(UINT)))
+	{
+		throw HrException(E_INVALIDARG);
+	}
+
+	// -- Lay out the sections -- //
+
+	MeshFileHeader header = {};
+	header.magic = Magic;
+	header.version = Version;
+	header.sourceHash = desc.sourceHash;
+	header.vertexCount = desc.vertexCount;
+	header.streamCount = desc.streamCount;
+	header.indexCount = desc.indexCount;
+	header.indexSize = desc.indexSize;
+	header.chunkCount = desc.chunkCount;
+	header.flags = desc.flags;
+	memcpy(header.boundsMin, desc.boundsMin, sizeof(desc.boundsMin));
+	memcpy(header.boundsMax, desc.boundsMax, sizeof(desc.boundsMax));
+	memcpy(header.positionScale, desc.positionScale, sizeof(header.positionScale));
+	memcpy(header.positionBias, desc.positionBias, sizeof(header.positionBias));
+
+	UINT64 offset = AlignSection(sizeof(MeshFileHeader));
+	for (UINT i = 0; i < desc.streamCount; i++)
+	{
+		header.streams[i].offset = offset;
+		header.streams[i].stride = desc.streamStrides[i];
+		offset = AlignSection(offset + static_cast<UINT64>(desc.vertexCount) * desc.streamStrides[i]);
+	}
+	header.indexOffset = offset;
+	offset = AlignSection(offset + static_cast<UINT64>(desc.indexCount) * desc.indexSize);
+	header.chunkOffset = offset;
+	header.fileSize = offset + static_cast<UINT64>(desc.chunkCount) * sizeof(IndexBufferBuilder::Chunk);
+
+	// -- Copy the data -- //
+
+	// the padding between sections stays zero, so the same mesh always gives the same bytes
+	std::vector<UINT8> data(static_cast<size_t>(header.fileSize), 0);
+	memcpy(data.data(), &header, sizeof(header));
+	for (UINT i = 0; i < desc.streamCount; i++)
+	{
+		memcpy(data.data() + header.streams[i].offset, desc.pStreamData[i], static_cast<size_t>(desc.vertexCount) * desc.streamStrides[i]);
+	}
+	memcpy(data.data() + header.indexOffset, desc.pIndexData, static_cast<size_t>(desc.indexCount) * desc.indexSize);
+	memcpy(data.data() + header.chunkOffset, desc.pChunks, desc.chunkCount * sizeof(IndexBufferBuilder::Chunk));
+
+	return data;
+}
+
+bool MeshFile::Open(LPCWSTR fileName, UINT64 sourceHash)
+{
+	Close();
+	if (!m_file.Open(fileName))
+	{
+		return false;
+	}
+
+	m_pData = static_cast<const UINT8*>(m_file.GetData());
+	m_size = m_file.GetSize();
+	if (!Validate(sourceHash))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool MeshFile::Open(std::vector<UINT8>&& data, UINT64 sourceHash)
+{
+	Close();
+	m_memory = std::move(data);
+	m_pData = m_memory.data();
+	m_size = m_memory.size();
+	if (!Validate(sourceHash))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MeshFile::Close()
+{
+	m_file.Close();
+	m_memory.clear();
+	m_pData = nullptr;
+	m_size = 0;
+}
+
+bool MeshFile::Validate(UINT64 sourceHash) const
+{
+	if (m_pData == nullptr || m_size < sizeof(MeshFileHeader))
+	{
+		return false;
+	}
+
+	const MeshFileHeader& header = GetHeader();
+	if (header.magic != Magic || header.version != Version || header.sourceHash != sourceHash || header.fileSize != m_size)
+	{
+		return false;
+	}
+	// the vertex buffer is created from the first stream, so there has to be one with vertices in it
+	if (header.streamCount == 0 || header.streamCount > MaxStreamCount || header.vertexCount == 0 || (header.indexSize != sizeof(UINT16) && header.indexSize != sizeof(UINT)))
+	{
+		return false;
+	}
+
+	// every section has to be inside the file, nothing is read past the mapping later
+	for (UINT i = 0; i < header.streamCount; i++)
+	{
+		if (header.streams[i].stride == 0 || !IsValidSection(header.streams[i].offset, GetStreamSize(i), m_size))
+		{
+			return false;
+		}
+	}
+	if (!IsValidSection(header.indexOffset, GetIndexDataSize(), m_size) ||
+		!IsValidSection(header.chunkOffset, static_cast<UINT64>(header.chunkCount) * sizeof(IndexBufferBuilder::Chunk), m_size))
+	{
+		return false;
+	}
+
+	// and the draws must stay inside the index data and start inside the vertices
+	const IndexBufferBuilder::Chunk* pChunks = GetChunks();
+	for (UINT i = 0; i < header.chunkCount; i++)
+	{
+		if (pChunks[i].startIndex > header.indexCount || pChunks[i].indexCount > header.indexCount - pChunks[i].startIndex)
+		{
+			return false;
+		}
+		if (pChunks[i].baseVertex < 0 || static_cast<UINT>(pChunks[i].baseVertex) >= header.vertexCount)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+
+#include "DXSampleHelper.h"
+#include "IndexBufferBuilder.h"
+#include "MappedFile.h"
+
+// where one vertex stream lives in the file
+struct MeshFileStream
+{
+	UINT64 offset; // from the start of the file
+	UINT stride; // bytes per vertex
+	UINT reserved;
+};
+
+// The fixed size header at the start of every mesh file. Every section it points to is
+// SectionAlignment aligned, so the mapping can be read in place.
+struct MeshFileHeader
+{
+	UINT magic; // MeshFile::Magic
+	UINT version; // MeshFile::Version
+	UINT64 sourceHash; // hash of what the file was imported from, a mismatch means it is stale
+	UINT vertexCount;
+	UINT streamCount;
+	UINT indexCount;
+	UINT indexSize; // 2 or 4 bytes
+	UINT chunkCount;
+	UINT flags; // MeshFileFlags
+	UINT64 indexOffset;
+	UINT64 chunkOffset; // IndexBufferBuilder::Chunk array, one draw each
+	UINT64 fileSize;
+	MeshFileStream streams[4]; // MeshFile::MaxStreamCount, the first streamCount are used
+	float boundsMin[4]; // xyz, w is unused
+	float boundsMax[4];
+	float positionScale[4]; // maps quantized positions back to the bounds, see VertexPacker
+	float positionBias[4];
+};
+
+static_assert(sizeof(MeshFileHeader) == 192, "the header is part of the file format");
+
+enum MeshFileFlags
+{
+	MeshFileFlagStrips = 0x1, // the indices are triangle strips cut by 0xffff or 0xffffffff
+};
+
+// A binary container for geometry in the form the gpu reads it: packed vertex streams,
+// index data ready for the index buffer, the draws the index data is split into, and the
+// bounds of the mesh. Open() maps the file and only validates the header, the data is
+// copied straight from the mapping into upload memory, so loading a large mesh costs
+// little more than that memcpy.
+class MeshFile
+{
+public:
+	static const UINT Magic = 0x4853454d; // "MESH"
+	static const UINT Version = 1;
+	static const UINT MaxStreamCount = 4;
+	static const UINT SectionAlignment = 16;
+
+	// what Serialize() writes, the data pointers are only read during the call
+	struct Desc
+	{
+		UINT64 sourceHash;
+		UINT vertexCount;
+		UINT streamCount;
+		const void* pStreamData[MaxStreamCount];
+		UINT streamStrides[MaxStreamCount];
+		const void* pIndexData;
+		UINT indexCount;
+		UINT indexSize;
+		const IndexBufferBuilder::Chunk* pChunks;
+		UINT chunkCount;
+		UINT flags;
+		float boundsMin[3];
+		float boundsMax[3];
+		float positionScale[4];
+		float positionBias[4];
+	};
+
+	MeshFile() : m_pData(nullptr), m_size(0) {}
+
+	// Lays the mesh out as a file, ready to be written or opened from memory.
+	static std::vector<UINT8> Serialize(const Desc& desc);
+
+	// Maps the file. Returns false if it is missing, truncated, written by another version,
+	// imported from something else than sourceHash, or not safe to draw: it needs at least
+	// one stream with a stride, and every chunk has to stay inside the indices and vertices.
+	bool Open(LPCWSTR fileName, UINT64 sourceHash);
+
+	// Same for a serialized mesh that was never written to disk, the file takes ownership of the data.
+	bool Open(std::vector<UINT8>&& data, UINT64 sourceHash);
+
+	void Close();
+
+	const MeshFileHeader& GetHeader() const { return *reinterpret_cast<const MeshFileHeader*>(m_pData); }
+	const void* GetStreamData(UINT stream) const { return m_pData + GetHeader().streams[stream].offset; }
+	UINT64 GetStreamSize(UINT stream) const { return static_cast<UINT64>(GetHeader().vertexCount) * GetHeader().streams[stream].stride; }
+	const void* GetIndexData() const { return m_pData + GetHeader().indexOffset; }
+	UINT64 GetIndexDataSize() const { return static_cast<UINT64>(GetHeader().indexCount) * GetHeader().indexSize; }
+	const IndexBufferBuilder::Chunk* GetChunks() const { return reinterpret_cast<const IndexBufferBuilder::Chunk*>(m_pData + GetHeader().chunkOffset); }
+
+private:
+	bool Validate(UINT64 sourceHash) const;
+
+	MappedFile m_file;
+	std::vector<UINT8> m_memory; // contents when opened from memory instead of a file
+	const UINT8* m_pData;
+	SIZE_T m_size;
+};
+
+static_assert(sizeof(MeshFileHeader::streams) / sizeof(MeshFileStream) == MeshFile::MaxStreamCount, "MeshFileHeader has room for every stream");
@@ -0,0 +1,251 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// tuning of the scoring function from Forsyth's article
+	const int32_t CacheSize = 32; // modelled cache, larger than real hardware on purpose
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// How much emitting a triangle that uses this vertex is worth. Vertices near the top of
+	// the cache score highest, and vertices with few triangles left get a boost so they are
+	// finished off instead of leaving lone triangles behind.
+	float VertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return -1.0f; // no triangles need this vertex anymore
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// it was used by the last triangle, which makes it too easy to just
+				// emit a strip, so this gets a fixed lower score
+				score = LastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (CacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		score += ValenceBoostScale * powf(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+		return score;
+	}
+}
+
+MeshOptimizer::MeshOptimizer(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount) :
+	m_indices(pIndices, pIndices + indexCount / 3 * 3)
+{
+	m_inputStatistics = AnalyzeVertexCache(m_indices.data(), GetIndexCount(), vertexCount);
+
+	OptimizeVertexCache(vertexCount);
+	OptimizeVertexFetch(vertexCount);
+
+	m_outputStatistics = AnalyzeVertexCache(m_indices.data(), GetIndexCount(), GetVertexCount());
+}
+
+void MeshOptimizer::RemapVertices(const void* pSource, uint32_t strideInBytes, void* pDestination) const
+{
+	const uint8_t* pIn = static_cast<const uint8_t*>(pSource);
+	uint8_t* pOut = static_cast<uint8_t*>(pDestination);
+	for (size_t i = 0; i < m_vertexRemap.size(); i++)
+	{
+		memcpy(pOut + i * strideInBytes, pIn + static_cast<size_t>(m_vertexRemap[i]) * strideInBytes, strideInBytes);
+	}
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	CacheStatistics statistics = {};
+
+	// the cache is a FIFO, a vertex is in it while its timestamp is within cacheSize of the latest miss
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t referencedCount = 0;
+
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		const uint32_t vertex = pIndices[i];
+		if (timestamp - cacheTimestamps[vertex] > cacheSize)
+		{
+			cacheTimestamps[vertex] = timestamp++;
+			statistics.transformedVertexCount++;
+		}
+		if (!referenced[vertex])
+		{
+			referenced[vertex] = true;
+			referencedCount++;
+		}
+	}
+
+	const uint32_t triangleCount = indexCount / 3;
+	statistics.acmr = triangleCount ? static_cast<float>(statistics.transformedVertexCount) / triangleCount : 0.0f;
+	statistics.atvr = referencedCount ? static_cast<float>(statistics.transformedVertexCount) / referencedCount : 0.0f;
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t vertexCount)
+{
+	const uint32_t* pIndices = m_indices.data();
+	const uint32_t triangleCount = GetIndexCount() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// -- Vertex to triangle adjacency -- //
+
+	std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		remainingTriangles[pIndices[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+	}
+
+	// triangles still to be emitted are kept at the front of each vertex's list
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				adjacency[fill[pIndices[t * 3 + corner]]++] = t;
+			}
+		}
+	}
+
+	// -- Initial scores -- //
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t bestTriangle = 0;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[pIndices[t * 3]] + vertexScores[pIndices[t * 3 + 1]] + vertexScores[pIndices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	// -- Emit triangles greedily -- //
+
+	std::vector<uint32_t> output(triangleCount * 3);
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(CacheSize + 3);
+	newCache.reserve(CacheSize + 3);
+	uint32_t scanCursor = 0; // everything before it has been emitted
+
+	for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (bestTriangle == UINT32_MAX)
+		{
+			// nothing in the cache has triangles left, continue with the next one not emitted
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = scanCursor;
+		}
+
+		const uint32_t* pTriangle = pIndices + bestTriangle * 3;
+		std::copy(pTriangle, pTriangle + 3, output.begin() + emittedCount * 3);
+		emitted[bestTriangle] = true;
+
+		// the triangle's vertices move to the top of the cache, the others are pushed down
+		newCache.assign(pTriangle, pTriangle + 3);
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != pTriangle[0] && vertex != pTriangle[1] && vertex != pTriangle[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		// the triangle is no longer available to its vertices
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = pTriangle[corner];
+			uint32_t* pBegin = adjacency.data() + adjacencyOffsets[vertex];
+			uint32_t* pEnd = pBegin + remainingTriangles[vertex];
+			std::iter_swap(std::find(pBegin, pEnd, bestTriangle), pEnd - 1);
+			remainingTriangles[vertex]--;
+		}
+
+		// rescore every vertex whose cache position changed, including the ones that fell out
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			const uint32_t vertex = newCache[i];
+			cachePositions[vertex] = i < CacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[vertex] = VertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+		}
+
+		// and with them the triangles they still have, the best of those goes next
+		bestTriangle = UINT32_MAX;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : newCache)
+		{
+			const uint32_t* pBegin = adjacency.data() + adjacencyOffsets[vertex];
+			for (const uint32_t* pTriangleIndex = pBegin; pTriangleIndex < pBegin + remainingTriangles[vertex]; pTriangleIndex++)
+			{
+				const uint32_t t = *pTriangleIndex;
+				triangleScores[t] = vertexScores[pIndices[t * 3]] + vertexScores[pIndices[t * 3 + 1]] + vertexScores[pIndices[t * 3 + 2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		newCache.resize(std::min<size_t>(newCache.size(), CacheSize));
+		cache.swap(newCache);
+	}
+
+	m_indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(uint32_t vertexCount)
+{
+	// vertices get their new number when the first triangle using them comes along
+	const uint32_t Unassigned = UINT32_MAX;
+	std::vector<uint32_t> newIndices(vertexCount, Unassigned);
+	m_vertexRemap.reserve(vertexCount);
+
+	for (uint32_t& index : m_indices)
+	{
+		uint32_t& newIndex = newIndices[index];
+		if (newIndex == Unassigned)
+		{
+			newIndex = GetVertexCount();
+			m_vertexRemap.push_back(index);
+		}
+		index = newIndex;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Reorders an indexed triangle list for the gpu at import time. The triangles are first
+// sorted so vertices are reused while they are still in the post-transform cache (Tom
+// Forsyth's linear-speed vertex cache optimization), which cuts vertex shader invocations.
+// The vertices are then renumbered in the order the triangles first use them, so fetching
+// them walks the vertex buffer forwards, and the indices are rewritten to match. Vertices
+// no triangle uses are dropped.
+//
+// Like the software rasterizer this only depends on the C++ standard library.
+class MeshOptimizer
+{
+public:
+	// entries of the FIFO cache the statistics are simulated with, roughly what current gpus reuse
+	static const uint32_t StatisticsCacheSize = 16;
+
+	// how well an index order uses the post-transform cache
+	struct CacheStatistics
+	{
+		uint32_t transformedVertexCount; // vertex shader invocations
+		float acmr; // average cache miss ratio, transformed vertices per triangle (3 means no reuse at all)
+		float atvr; // average transformed vertex ratio, transformed vertices per referenced vertex (1 is ideal)
+	};
+
+	MeshOptimizer(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+	const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+	uint32_t GetIndexCount() const { return static_cast<uint32_t>(m_indices.size()); }
+
+	// Output vertex i is input vertex GetVertexRemap()[i].
+	const std::vector<uint32_t>& GetVertexRemap() const { return m_vertexRemap; }
+	uint32_t GetVertexCount() const { return static_cast<uint32_t>(m_vertexRemap.size()); } // number of output vertices
+
+	// Copies the input vertices into their output order, pDestination has room for GetVertexCount() vertices.
+	void RemapVertices(const void* pSource, uint32_t strideInBytes, void* pDestination) const;
+
+	const CacheStatistics& GetInputStatistics() const { return m_inputStatistics; } // as authored
+	const CacheStatistics& GetOutputStatistics() const { return m_outputStatistics; } // after optimizing
+
+	// Simulates a FIFO post-transform cache of cacheSize entries over a triangle list.
+	static CacheStatistics AnalyzeVertexCache(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = StatisticsCacheSize);
+
+private:
+	void OptimizeVertexCache(uint32_t vertexCount);
+	void OptimizeVertexFetch(uint32_t vertexCount);
+
+	std::vector<uint32_t> m_indices;
+	std::vector<uint32_t> m_vertexRemap;
+	CacheStatistics m_inputStatistics;
+	CacheStatistics m_outputStatistics;
+};
@@ -0,0 +1,212 @@
+#include "stdafx.h"
+#include "MeshletBuilder.h"
+
+#include <cmath>
+#include <future>
+
+namespace
+{
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	Float3 Subtract(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Float3 Cross(const Float3& a, const Float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+	Float3 LoadPosition(const MeshletBuilder::Mesh& mesh, UINT vertex)
+	{
+		Float3 position;
+		memcpy(&position, static_cast<const UINT8*>(mesh.pVertices) + static_cast<SIZE_T>(vertex) * mesh.strideInBytes + mesh.positionOffset, sizeof(position));
+		return position;
+	}
+
+	// Ritter's bounding sphere: start with the two points furthest apart along one sweep,
+	// then grow the sphere over every point still outside. Not minimal, but within a few
+	// percent of it and deterministic.
+	void ComputeBoundingSphere(const std::vector<Float3>& points, Float3& center, float& radius)
+	{
+		const Float3& p0 = points[0];
+		const Float3* p1 = &points[0];
+		for (const Float3& p : points)
+		{
+			if (Dot(Subtract(p, p0), Subtract(p, p0)) > Dot(Subtract(*p1, p0), Subtract(*p1, p0)))
+			{
+				p1 = &p;
+			}
+		}
+		const Float3* p2 = p1;
+		for (const Float3& p : points)
+		{
+			if (Dot(Subtract(p, *p1), Subtract(p, *p1)) > Dot(Subtract(*p2, *p1), Subtract(*p2, *p1)))
+			{
+				p2 = &p;
+			}
+		}
+
+		center = { (p1->x + p2->x) * 0.5f, (p1->y + p2->y) * 0.5f, (p1->z + p2->z) * 0.5f };
+		radius = sqrtf(Dot(Subtract(*p2, *p1), Subtract(*p2, *p1))) * 0.5f;
+
+		for (const Float3& p : points)
+		{
+			const float distance = sqrtf(Dot(Subtract(p, center), Subtract(p, center)));
+			if (distance > radius)
+			{
+				// move the center towards the point just enough to include it
+				const float newRadius = (radius + distance) * 0.5f;
+				const float k = (newRadius - radius) / distance;
+				center = { center.x + (p.x - center.x) * k, center.y + (p.y - center.y) * k, center.z + (p.z - center.z) * k };
+				radius = newRadius;
+			}
+		}
+	}
+
+	void FinishMeshlet(const MeshletBuilder::Mesh& mesh, MeshletBuilder::Meshlets& meshlets, std::vector<Float3>& points)
+	{
+		const UINT vertexOffset = meshlets.vertexOffsets.back();
+		const UINT vertexCount = meshlets.vertexCounts.back();
+		const UINT triangleOffset = meshlets.triangleOffsets.back();
+		const UINT triangleCount = meshlets.triangleCounts.back();
+
+		// -- Bounding sphere -- //
+
+		points.clear();
+		for (UINT i = 0; i < vertexCount; i++)
+		{
+			points.push_back(LoadPosition(mesh, meshlets.vertexIndices[vertexOffset + i]));
+		}
+
+		Float3 center;
+		float radius;
+		ComputeBoundingSphere(points, center, radius);
+		meshlets.centerX.push_back(center.x);
+		meshlets.centerY.push_back(center.y);
+		meshlets.centerZ.push_back(center.z);
+		meshlets.radius.push_back(radius);
+
+		// -- Normal cone -- //
+
+		// the axis is the average of the triangle normals, the cutoff comes from the normal furthest from it
+		std::vector<Float3> normals;
+		normals.reserve(triangleCount);
+		Float3 axis = { 0.0f, 0.0f, 0.0f };
+		for (UINT t = 0; t < triangleCount; t++)
+		{
+			const UINT8* pTriangle = &meshlets.triangleIndices[(triangleOffset + t) * 3];
+			const Float3 normal = Cross(Subtract(points[pTriangle[1]], points[pTriangle[0]]), Subtract(points[pTriangle[2]], points[pTriangle[0]]));
+			const float length = sqrtf(Dot(normal, normal));
+			if (length > 0.0f) // degenerate triangles can't be seen from any side
+			{
+				normals.push_back({ normal.x / length, normal.y / length, normal.z / length });
+				axis = { axis.x + normals.back().x, axis.y + normals.back().y, axis.z + normals.back().z };
+			}
+		}
+
+		float cutoff = 1.0f; // never culled
+		const float axisLength = sqrtf(Dot(axis, axis));
+		if (axisLength > 0.0f)
+		{
+			axis = { axis.x / axisLength, axis.y / axisLength, axis.z / axisLength };
+
+			float minDot = 1.0f;
+			for (const Float3& normal : normals)
+			{
+				minDot = min(minDot, Dot(normal, axis));
+			}
+
+			// normals more than 90 degrees apart face both ways, such a meshlet is always visible
+			if (minDot > 0.0f)
+			{
+				cutoff = sqrtf(1.0f - minDot * minDot);
+			}
+		}
+		meshlets.coneAxisX.push_back(axis.x);
+		meshlets.coneAxisY.push_back(axis.y);
+		meshlets.coneAxisZ.push_back(axis.z);
+		meshlets.coneCutoff.push_back(cutoff);
+	}
+}
+
+MeshletBuilder::Meshlets MeshletBuilder::Build(const Mesh& mesh)
+{
+	Meshlets meshlets;
+
+	// local index of every mesh vertex in the current meshlet, or Unassigned when it isn't in it yet
+	const UINT Unassigned = UINT_MAX;
+	std::vector<UINT> localIndices(mesh.vertexCount, Unassigned);
+	std::vector<Float3> points;
+	points.reserve(MaxVertexCount);
+
+	for (UINT i = 0; i + 2 < mesh.indexCount; i += 3)
+	{
+		const UINT* pTriangle = mesh.pIndices + i;
+
+		UINT newVertexCount = 0;
+		for (UINT corner = 0; corner < 3; corner++)
+		{
+			// a triangle that repeats a vertex only needs it once
+			const bool repeated = (corner > 0 && pTriangle[corner] == pTriangle[0]) || (corner > 1 && pTriangle[corner] == pTriangle[1]);
+			if (localIndices[pTriangle[corner]] == Unassigned && !repeated)
+			{
+				newVertexCount++;
+			}
+		}
+
+		// start a new meshlet when the triangle doesn't fit into the current one
+		if (meshlets.GetCount() == 0 ||
+			meshlets.vertexCounts.back() + newVertexCount > MaxVertexCount ||
+			meshlets.triangleCounts.back() + 1u > MaxTriangleCount)
+		{
+			if (meshlets.GetCount() > 0)
+			{
+				FinishMeshlet(mesh, meshlets, points);
+				for (UINT v = meshlets.vertexOffsets.back(); v < meshlets.vertexIndices.size(); v++)
+				{
+					localIndices[meshlets.vertexIndices[v]] = Unassigned;
+				}
+			}
+
+			meshlets.vertexOffsets.push_back(static_cast<UINT>(meshlets.vertexIndices.size()));
+			meshlets.vertexCounts.push_back(0);
+			meshlets.triangleOffsets.push_back(static_cast<UINT>(meshlets.triangleIndices.size() / 3));
+			meshlets.triangleCounts.push_back(0);
+		}
+
+		for (UINT corner = 0; corner < 3; corner++)
+		{
+			UINT& localIndex = localIndices[pTriangle[corner]];
+			if (localIndex == Unassigned)
+			{
+				localIndex = meshlets.vertexCounts.back()++;
+				meshlets.vertexIndices.push_back(pTriangle[corner]);
+			}
+			meshlets.triangleIndices.push_back(static_cast<UINT8>(localIndex));
+		}
+		meshlets.triangleCounts.back()++;
+	}
+
+	if (meshlets.GetCount() > 0)
+	{
+		FinishMeshlet(mesh, meshlets, points);
+	}
+
+	return meshlets;
+}
+
+std::vector<MeshletBuilder::Meshlets> MeshletBuilder::Build(ThreadPool& threadPool, const std::vector<Mesh>& meshes)
+{
+	// the meshes are independent, so which thread builds which doesn't change the result
+	std::vector<std::future<Meshlets>> futures;
+	for (const Mesh& mesh : meshes)
+	{
+		futures.push_back(threadPool.Submit([&mesh]() { return Build(mesh); }));
+	}
+
+	std::vector<Meshlets> results;
+	for (std::future<Meshlets>& future : futures)
+	{
+		results.push_back(future.get());
+	}
+	return results;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "DXSampleHelper.h"
+#include "ThreadPool.h"
+
+// Splits triangle lists into meshlets, small clusters of at most MaxVertexCount vertices and
+// MaxTriangleCount triangles that become the unit of culling and of future mesh shader draws.
+// Triangles are taken in index order, so running the MeshOptimizer first gives tighter
+// meshlets. Every meshlet gets a bounding sphere and a cone around its triangle normals.
+//
+// The output of a mesh is stored as one array per field rather than an array of structs,
+// so a culling pass only touches the fields it tests. The builder is deterministic, the same
+// input always gives the same meshlets no matter how many threads build them.
+class MeshletBuilder
+{
+public:
+	// 124 rather than 126 triangles keeps the 3 byte triangles of a full meshlet a multiple of 4 bytes
+	static const UINT MaxVertexCount = 64;
+	static const UINT MaxTriangleCount = 124;
+
+	// the same vertex and index arrays LoadResource() uploads
+	struct Mesh
+	{
+		const void* pVertices;
+		UINT vertexCount;
+		UINT strideInBytes;
+		UINT positionOffset; // float3 position
+		const UINT* pIndices; // triangle list
+		UINT indexCount;
+	};
+
+	// The meshlets of one mesh, meshlet i is element i of every array except the last two.
+	//
+	// A meshlet can be skipped when it faces away from the camera if
+	//   dot(center - cameraPosition, coneAxis) >= coneCutoff * length(center - cameraPosition) + radius
+	// and coneCutoff is 1 for meshlets whose normals are spread too wide to ever pass that.
+	struct Meshlets
+	{
+		UINT GetCount() const { return static_cast<UINT>(vertexOffsets.size()); }
+
+		std::vector<UINT> vertexOffsets; // first entry in vertexIndices
+		std::vector<UINT8> vertexCounts;
+		std::vector<UINT> triangleOffsets; // first triangle in triangleIndices, 3 entries each
+		std::vector<UINT8> triangleCounts;
+
+		std::vector<float> centerX; // bounding sphere
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+
+		std::vector<float> coneAxisX; // normal cone
+		std::vector<float> coneAxisY;
+		std::vector<float> coneAxisZ;
+		std::vector<float> coneCutoff; // sine of the angle between the axis and the furthest normal
+
+		std::vector<UINT> vertexIndices; // mesh vertex of each meshlet vertex
+		std::vector<UINT8> triangleIndices; // meshlet local vertex indices, 3 per triangle
+	};
+
+	static Meshlets Build(const Mesh& mesh);
+
+	// Builds each mesh as its own task on the pool. The results are in the order of the meshes.
+	static std::vector<Meshlets> Build(ThreadPool& threadPool, const std::vector<Mesh>& meshes);
+};
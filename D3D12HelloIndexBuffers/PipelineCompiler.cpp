@@ -0,0 +1,55 @@
+#include "stdafx.h"
+#include "PipelineCompiler.h"
+
+PipelineCompiler::PipelineCompiler(ThreadPool& threadPool, ID3D12Device* pDevice, PipelineStateCache* pPipelineCache, ShaderCache* pShaderCache) :
+	m_threadPool(threadPool),
+	m_device(pDevice),
+	m_pPipelineCache(pPipelineCache),
+	m_pShaderCache(pShaderCache)
+{
+}
+
+PipelineCompiler::ShaderFuture PipelineCompiler::CompileShaderAsync(LPCWSTR fileName, LPCSTR entryPoint, LPCSTR target, UINT flags)
+{
+	ShaderCache* pShaderCache = m_pShaderCache;
+	return m_threadPool.Submit([=]()
+	{
+		if (pShaderCache)
+		{
+			return pShaderCache->CompileFromFile(fileName, nullptr, entryPoint, target, flags);
+		}
+
+		ComPtr<ID3DBlob> bytecode;
+		ThrowIfFailed(D3DCompileFromFile(fileName, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, target, flags, 0, &bytecode, nullptr));
+		return bytecode;
+	}).share();
+}
+
+PipelineCompiler::PipelineFuture PipelineCompiler::CreateGraphicsPipelineAsync(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ShaderFuture vertexShader, ShaderFuture pixelShader)
+{
+	ComPtr<ID3D12Device> device = m_device;
+	PipelineStateCache* pPipelineCache = m_pPipelineCache;
+	return m_threadPool.Submit([=]()
+	{
+		// The shaders were submitted to the pool before this task, so they are
+		// already running or done by the time we wait on them here.
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = desc;
+		if (vertexShader.valid())
+		{
+			psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.get().Get());
+		}
+		if (pixelShader.valid())
+		{
+			psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.get().Get());
+		}
+
+		if (pPipelineCache)
+		{
+			return pPipelineCache->GetGraphicsPipelineState(psoDesc);
+		}
+
+		ComPtr<ID3D12PipelineState> pipelineState;
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+		return pipelineState;
+	}).share();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <future>
+
+#include "PipelineStateCache.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+
+// Fans shader compilation and pso creation out over a thread pool so startup time
+// scales with the number of cores instead of the number of psos. Everything returns
+// a future the render setup joins on when it actually needs the result.
+class PipelineCompiler
+{
+public:
+	typedef std::shared_future<ComPtr<ID3DBlob>> ShaderFuture;
+	typedef std::shared_future<ComPtr<ID3D12PipelineState>> PipelineFuture;
+
+	// pShaderCache may be null to always compile, pPipelineCache may be null to always create the pso
+	PipelineCompiler(ThreadPool& threadPool, ID3D12Device* pDevice, PipelineStateCache* pPipelineCache, ShaderCache* pShaderCache);
+
+	// Compiles one entry point of an hlsl file on the pool.
+	ShaderFuture CompileShaderAsync(LPCWSTR fileName, LPCSTR entryPoint, LPCSTR target, UINT flags);
+
+	// Creates a pso on the pool once the given shaders have compiled. Shader futures that
+	// aren't valid() keep whatever bytecode desc already has. The desc is copied, but the
+	// arrays it points to (such as the input layout) must stay alive until the pso is done.
+	PipelineFuture CreateGraphicsPipelineAsync(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ShaderFuture vertexShader, ShaderFuture pixelShader);
+
+private:
+	ThreadPool& m_threadPool;
+	ComPtr<ID3D12Device> m_device;
+	PipelineStateCache* m_pPipelineCache;
+	ShaderCache* m_pShaderCache;
+};
@@ -0,0 +1,259 @@
+#include "stdafx.h"
+#include "PipelineStateCache.h"
+#include "Hash.h"
+
+#include <vector>
+
+namespace
+{
+	void HashShaderBytecode(Hasher& hasher, const D3D12_SHADER_BYTECODE& shader)
+	{
+		hasher.AddValue(shader.BytecodeLength);
+		hasher.Add(shader.pShaderBytecode, shader.BytecodeLength);
+	}
+
+	// the state descs contain padding after their UINT8 members, so hash them field by field
+	void HashBlendDesc(Hasher& hasher, const D3D12_BLEND_DESC& desc)
+	{
+		hasher.AddValue(desc.AlphaToCoverageEnable);
+		hasher.AddValue(desc.IndependentBlendEnable);
+		for (const D3D12_RENDER_TARGET_BLEND_DESC& rt : desc.RenderTarget)
+		{
+			hasher.AddValue(rt.BlendEnable);
+			hasher.AddValue(rt.LogicOpEnable);
+			hasher.AddValue(rt.SrcBlend);
+			hasher.AddValue(rt.DestBlend);
+			hasher.AddValue(rt.BlendOp);
+			hasher.AddValue(rt.SrcBlendAlpha);
+			hasher.AddValue(rt.DestBlendAlpha);
+			hasher.AddValue(rt.BlendOpAlpha);
+			hasher.AddValue(rt.LogicOp);
+			hasher.AddValue(rt.RenderTargetWriteMask);
+		}
+	}
+
+	void HashStencilOpDesc(Hasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& desc)
+	{
+		hasher.AddValue(desc.StencilFailOp);
+		hasher.AddValue(desc.StencilDepthFailOp);
+		hasher.AddValue(desc.StencilPassOp);
+		hasher.AddValue(desc.StencilFunc);
+	}
+
+	void HashDepthStencilDesc(Hasher& hasher, const D3D12_DEPTH_STENCIL_DESC& desc)
+	{
+		hasher.AddValue(desc.DepthEnable);
+		hasher.AddValue(desc.DepthWriteMask);
+		hasher.AddValue(desc.DepthFunc);
+		hasher.AddValue(desc.StencilEnable);
+		hasher.AddValue(desc.StencilReadMask);
+		hasher.AddValue(desc.StencilWriteMask);
+		HashStencilOpDesc(hasher, desc.FrontFace);
+		HashStencilOpDesc(hasher, desc.BackFace);
+	}
+}
+
+PipelineStateCache::PipelineStateCache(ID3D12Device* pDevice, ID3D12PipelineLibrary* pLibrary) :
+	m_device(pDevice),
+	m_library(pLibrary),
+	m_dirty(false),
+	m_hitCount(0),
+	m_missCount(0)
+{
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+	// release the library before the file mapping it was created from
+	m_library.Reset();
+	m_cacheFile.Close();
+}
+
+std::unique_ptr<PipelineStateCache> PipelineStateCache::Open(ID3D12Device* pDevice, LPCWSTR fileName)
+{
+	std::unique_ptr<PipelineStateCache> cache(new PipelineStateCache(pDevice, nullptr));
+	cache->m_fileName = fileName;
+
+	// pipeline libraries need ID3D12Device1
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(pDevice->QueryInterface(IID_PPV_ARGS(&device1))))
+	{
+		return cache;
+	}
+
+	// the library reads the mapped file in place, no copy of the blob is made
+	HRESULT hr = E_FAIL;
+	if (cache->m_cacheFile.Open(fileName))
+	{
+		hr = device1->CreatePipelineLibrary(cache->m_cacheFile.GetData(), cache->m_cacheFile.GetSize(), IID_PPV_ARGS(&cache->m_library));
+	}
+
+	if (FAILED(hr))
+	{
+		// The file is missing, corrupt, or was written for a different adapter or driver
+		// version (D3D12_ERROR_ADAPTER_NOT_FOUND / D3D12_ERROR_DRIVER_VERSION_MISMATCH).
+		// Start over with an empty library, it gets written back on Save().
+		cache->m_cacheFile.Close();
+		hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&cache->m_library));
+		if (hr == DXGI_ERROR_UNSUPPORTED)
+		{
+			// the driver doesn't support pipeline libraries, psos are simply compiled every time
+			cache->m_library.Reset();
+			return cache;
+		}
+		ThrowIfFailed(hr);
+	}
+
+	return cache;
+}
+
+void PipelineStateCache::RegisterRootSignature(ID3D12RootSignature* pRootSignature, const void* pSerializedData, SIZE_T serializedSize)
+{
+	Hasher hasher;
+	hasher.Add(pSerializedData, serializedSize);
+	m_rootSignatureHashes[pRootSignature] = hasher.GetValue();
+}
+
+UINT64 PipelineStateCache::HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const
+{
+	Hasher hasher;
+
+	// the root signature pointer changes from run to run, its serialized contents don't
+	auto rootSignature = m_rootSignatureHashes.find(desc.pRootSignature);
+	if (desc.pRootSignature && rootSignature == m_rootSignatureHashes.end())
+	{
+		throw HrException(E_INVALIDARG);
+	}
+	hasher.AddValue(desc.pRootSignature ? rootSignature->second : 0ull);
+
+	HashShaderBytecode(hasher, desc.VS);
+	HashShaderBytecode(hasher, desc.PS);
+	HashShaderBytecode(hasher, desc.DS);
+	HashShaderBytecode(hasher, desc.HS);
+	HashShaderBytecode(hasher, desc.GS);
+
+	hasher.AddValue(desc.StreamOutput.NumEntries);
+	for (UINT i = 0; i < desc.StreamOutput.NumEntries; i++)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = desc.StreamOutput.pSODeclaration[i];
+		hasher.AddValue(entry.Stream);
+		hasher.AddString(entry.SemanticName);
+		hasher.AddValue(entry.SemanticIndex);
+		hasher.AddValue(entry.StartComponent);
+		hasher.AddValue(entry.ComponentCount);
+		hasher.AddValue(entry.OutputSlot);
+	}
+	hasher.AddValue(desc.StreamOutput.NumStrides);
+	hasher.Add(desc.StreamOutput.pBufferStrides, desc.StreamOutput.NumStrides * sizeof(UINT));
+	hasher.AddValue(desc.StreamOutput.RasterizedStream);
+
+	HashBlendDesc(hasher, desc.BlendState);
+	hasher.AddValue(desc.SampleMask);
+	hasher.AddValue(desc.RasterizerState); // only 4 byte members, no padding
+	HashDepthStencilDesc(hasher, desc.DepthStencilState);
+
+	hasher.AddValue(desc.InputLayout.NumElements);
+	for (UINT i = 0; i < desc.InputLayout.NumElements; i++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hasher.AddString(element.SemanticName);
+		hasher.AddValue(element.SemanticIndex);
+		hasher.AddValue(element.Format);
+		hasher.AddValue(element.InputSlot);
+		hasher.AddValue(element.AlignedByteOffset);
+		hasher.AddValue(element.InputSlotClass);
+		hasher.AddValue(element.InstanceDataStepRate);
+	}
+
+	hasher.AddValue(desc.IBStripCutValue);
+	hasher.AddValue(desc.PrimitiveTopologyType);
+	hasher.AddValue(desc.NumRenderTargets);
+	hasher.AddValue(desc.RTVFormats);
+	hasher.AddValue(desc.DSVFormat);
+	hasher.AddValue(desc.SampleDesc);
+	hasher.AddValue(desc.NodeMask);
+	hasher.AddValue(desc.Flags);
+
+	return hasher.GetValue();
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	ComPtr<ID3D12PipelineState> pipelineState;
+
+	if (!m_library)
+	{
+		m_missCount++;
+		return CreateGraphicsPipelineState(desc);
+	}
+
+	WCHAR name[17];
+	swprintf_s(name, L"%016llX", HashGraphicsPipelineDesc(desc));
+
+	// E_INVALIDARG means the pso isn't in the library, or is stored with a different description
+	HRESULT hr;
+	{
+		std::lock_guard<std::mutex> lock(m_libraryMutex);
+		hr = m_library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(&pipelineState));
+	}
+	if (SUCCEEDED(hr))
+	{
+		m_hitCount++;
+		return pipelineState;
+	}
+
+	// the expensive part runs without the lock so misses compile in parallel
+	m_missCount++;
+	pipelineState = CreateGraphicsPipelineState(desc);
+
+	// Failing to store only means the next run has to compile it again. This also
+	// happens when another thread stored the same pso first (E_INVALIDARG).
+	{
+		std::lock_guard<std::mutex> lock(m_libraryMutex);
+		hr = m_library->StorePipeline(name, pipelineState.Get());
+	}
+	if (SUCCEEDED(hr))
+	{
+		m_dirty = true;
+	}
+
+	return pipelineState;
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	ComPtr<ID3D12PipelineState> pipelineState;
+	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+	return pipelineState;
+}
+
+void PipelineStateCache::Save()
+{
+	if (!m_library || !m_dirty || m_fileName.empty())
+	{
+		return;
+	}
+
+	// A cache that can't be written only costs compile time on the next run, so failures
+	// are reported instead of thrown; this runs on shutdown.
+	std::vector<UINT8> data(m_library->GetSerializedSize());
+	if (FAILED(m_library->Serialize(data.data(), data.size())))
+	{
+		OutputDebugStringW(L"PipelineStateCache: failed to serialize the pipeline library\n");
+		return;
+	}
+
+	// the file can't be replaced while it is mapped
+	m_library.Reset();
+	m_cacheFile.Close();
+
+	// written through a temporary file, so a crash or a short write leaves the old cache intact
+	if (!WriteFileAtomic(m_fileName.c_str(), data.data(), data.size()))
+	{
+		WCHAR message[MAX_PATH + 64];
+		swprintf_s(message, L"PipelineStateCache: failed to write %ls\n", m_fileName.c_str());
+		OutputDebugStringW(message);
+		return;
+	}
+	m_dirty = false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "DXSampleHelper.h"
+#include "MappedFile.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Caches compiled pipeline state objects across runs. Each pso is keyed by a hash of its
+// full D3D12_GRAPHICS_PIPELINE_STATE_DESC (including the shader bytecode, the input layout
+// and the serialized root signature) and stored in an ID3D12PipelineLibrary. The library
+// is created directly on top of a memory mapped cache file, so a warm start only has to
+// hand the driver a pointer instead of compiling every pso from scratch.
+//
+// GetGraphicsPipelineState() may be called from several threads at once. Registering root
+// signatures and Save() are not thread safe and belong before and after the parallel work.
+class PipelineStateCache
+{
+public:
+	// Uses the given library for lookups, or always compiles when pLibrary is null.
+	// This is also how a stand-in library can be plugged in, see CreateGraphicsPipelineState().
+	PipelineStateCache(ID3D12Device* pDevice, ID3D12PipelineLibrary* pLibrary);
+	virtual ~PipelineStateCache();
+
+	// Maps the cache file and creates a pipeline library from its contents. Starts with an
+	// empty library if the file is missing or was written by another adapter or driver, and
+	// without a library when the device doesn't support them.
+	static std::unique_ptr<PipelineStateCache> Open(ID3D12Device* pDevice, LPCWSTR fileName);
+
+	// Root signatures are only known to the cache by their serialized form, so every root
+	// signature used in a pso description has to be registered before it is looked up.
+	void RegisterRootSignature(ID3D12RootSignature* pRootSignature, const void* pSerializedData, SIZE_T serializedSize);
+
+	// Returns the pso from the library, or creates it and adds it to the library.
+	ComPtr<ID3D12PipelineState> GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	// Writes the library back to the file it was opened from if new psos were added. The
+	// library references the mapped file, so it is released first and the cache just compiles
+	// psos from then on. The file is replaced atomically, and a failure is only reported with
+	// OutputDebugString since the cache is recreated next run. This is meant to be called on shutdown.
+	void Save();
+
+	// Hashes everything in the description that affects the compiled pso.
+	UINT64 HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const;
+
+	UINT GetHitCount() const { return m_hitCount; }
+	UINT GetMissCount() const { return m_missCount; }
+
+protected:
+	// compiles a pso on a miss, tests can override this to hand out stand-ins
+	virtual ComPtr<ID3D12PipelineState> CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+private:
+	ComPtr<ID3D12Device> m_device;
+	MappedFile m_cacheFile; // backing memory of the library, declared first so it outlives it
+	ComPtr<ID3D12PipelineLibrary> m_library;
+	std::wstring m_fileName;
+	std::map<ID3D12RootSignature*, UINT64> m_rootSignatureHashes;
+	std::mutex m_libraryMutex; // loads of the same pso from several threads have to be serialized
+	std::atomic<bool> m_dirty; // psos were added since the library was loaded
+	std::atomic<UINT> m_hitCount;
+	std::atomic<UINT> m_missCount;
+};
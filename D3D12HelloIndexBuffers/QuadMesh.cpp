@@ -0,0 +1,45 @@
+#include "QuadMesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+// triangle vertices with color
+const QuadVertex QuadVertices[] =
+{
+	{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+	{ { 0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f  } },
+	{ { -0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+	{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } }
+};
+
+// a quad (two triangles)
+const uint32_t QuadIndices[] =
+{
+	0, 1 , 2, // first triangle (left-bottom)
+	0, 3, 1 // second triangle (right-top)
+};
+
+std::vector<QuadInstance> CreateQuadInstances(uint32_t instanceCount)
+{
+	const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+	const uint32_t rows = (instanceCount + columns - 1) / columns;
+
+	std::vector<QuadInstance> instances(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		const uint32_t column = i % columns;
+		const uint32_t row = i / columns;
+
+		// the quad spans half a cell, centered in it
+		QuadInstance& instance = instances[i];
+		instance.transform[0] = 1.0f / columns;
+		instance.transform[1] = 1.0f / rows;
+		instance.transform[2] = -1.0f + (column + 0.5f) * 2.0f / columns;
+		instance.transform[3] = 1.0f - (row + 0.5f) * 2.0f / rows;
+
+		// shade the quads from dim in the top left to full brightness in the bottom right
+		const uint32_t brightness = instanceCount == 1 ? 255 : 128 + 127 * (column + row) / (std::max)(columns + rows - 2, 1u);
+		instance.color = brightness | (brightness << 8) | (brightness << 16) | (255u << 24);
+	}
+	return instances;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// The quad the sample draws, as authored, and the grid its instances are laid out in.
+// Shared by the d3d12 path, the software rasterizer and the portable headless build, so
+// like the software rasterizer this only depends on the C++ standard library.
+
+// vertex structure, POSITION (float3) and COLOR (float4)
+struct QuadVertex
+{
+	float position[3];
+	float color[4];
+};
+
+// per instance data of the second input slot
+struct QuadInstance
+{
+	float transform[4]; // xy scale and zw offset of the quad
+	uint32_t color; // R8G8B8A8_UNORM, multiplied with the vertex color
+};
+
+extern const QuadVertex QuadVertices[4];
+extern const uint32_t QuadIndices[6];
+
+// Lays instanceCount quads out in a grid over the viewport, a single quad keeps the size and color it was authored with.
+std::vector<QuadInstance> CreateQuadInstances(uint32_t instanceCount);
@@ -0,0 +1,249 @@
+#include "stdafx.h"
+#include "ResourceStateTracker.h"
+
+namespace
+{
+	// the registry the trackers resolve pending barriers against
+	struct GlobalResourceState
+	{
+		D3D12_RESOURCE_STATES state; // the state of subresources without an entry
+		std::map<UINT, D3D12_RESOURCE_STATES> subresourceStates;
+		UINT subresourceCount;
+	};
+
+	std::mutex g_globalMutex;
+	std::map<ID3D12Resource*, GlobalResourceState> g_globalStates;
+}
+
+D3D12_RESOURCE_STATES ResourceStateTracker::ResourceState::Get(UINT subresource) const
+{
+	auto found = subresourceStates.find(subresource);
+	return found != subresourceStates.end() ? found->second : state;
+}
+
+void ResourceStateTracker::ResourceState::Set(UINT subresource, D3D12_RESOURCE_STATES newState)
+{
+	if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+	{
+		state = newState;
+		subresourceStates.clear();
+	}
+	else
+	{
+		subresourceStates[subresource] = newState;
+	}
+}
+
+ResourceStateTracker::ResourceStateTracker()
+{
+}
+
+void ResourceStateTracker::TransitionResource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT subresource)
+{
+	AddTransition(pResource, stateAfter, subresource, false);
+}
+
+void ResourceStateTracker::TransitionSubresource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT mipSlice, UINT arraySlice, UINT planeSlice)
+{
+	const D3D12_RESOURCE_DESC desc = pResource->GetDesc();
+	const UINT arraySize = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+	AddTransition(pResource, stateAfter, D3D12CalcSubresource(mipSlice, arraySlice, planeSlice, desc.MipLevels, arraySize), false);
+}
+
+void ResourceStateTracker::BeginTransition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT subresource)
+{
+	AddTransition(pResource, stateAfter, subresource, true);
+}
+
+void ResourceStateTracker::EndTransition(ID3D12Resource* pResource, UINT subresource)
+{
+	for (size_t i = 0; i < m_openSplitTransitions.size(); i++)
+	{
+		const SplitTransition& split = m_openSplitTransitions[i];
+		const bool overlaps = subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || split.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || split.subresource == subresource;
+		if (split.pResource == pResource && overlaps)
+		{
+			m_barriers.Transition(split.pResource, split.stateBefore, split.stateAfter, split.subresource, split.begun ? D3D12_RESOURCE_BARRIER_FLAG_END_ONLY : D3D12_RESOURCE_BARRIER_FLAG_NONE);
+			m_openSplitTransitions.erase(m_openSplitTransitions.begin() + i);
+			i--;
+		}
+	}
+}
+
+void ResourceStateTracker::EndSplitTransitions()
+{
+	for (const SplitTransition& split : m_openSplitTransitions)
+	{
+		m_barriers.Transition(split.pResource, split.stateBefore, split.stateAfter, split.subresource, split.begun ? D3D12_RESOURCE_BARRIER_FLAG_END_ONLY : D3D12_RESOURCE_BARRIER_FLAG_NONE);
+	}
+	m_openSplitTransitions.clear();
+}
+
+void ResourceStateTracker::AddTransition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT subresource, bool split)
+{
+	// a split transition still in flight has to end before the resource can move on
+	EndTransition(pResource, subresource);
+
+	ResourceState& finalState = m_finalStates[pResource];
+
+	// Transitioning all subresources while they are in different states takes one
+	// barrier per subresource, each starting from that subresource's own state.
+	UINT firstSubresource = subresource;
+	UINT subresourceCount = 1;
+	if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !finalState.subresourceStates.empty())
+	{
+		firstSubresource = 0;
+		subresourceCount = GetSubresourceCount(pResource);
+	}
+
+	for (UINT n = 0; n < subresourceCount; n++)
+	{
+		const UINT i = firstSubresource + n;
+		const D3D12_RESOURCE_STATES stateBefore = finalState.Get(i);
+		if (stateBefore == UnknownState)
+		{
+			// the first use of the subresource in this list, the state before is resolved on submission
+			m_pendingBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource, D3D12_RESOURCE_STATE_COMMON, stateAfter, i));
+		}
+		else if (stateBefore != stateAfter)
+		{
+			if (split)
+			{
+				// recorded on the next flush, so a begin and its end never land in the same ResourceBarrier call
+				m_openSplitTransitions.push_back({ pResource, i, stateBefore, stateAfter, false });
+			}
+			else
+			{
+				m_barriers.Transition(pResource, stateBefore, stateAfter, i);
+			}
+		}
+	}
+
+	finalState.Set(subresource, stateAfter);
+}
+
+void ResourceStateTracker::FlushResourceBarriers(ID3D12GraphicsCommandList* pCommandList)
+{
+	for (SplitTransition& split : m_openSplitTransitions)
+	{
+		if (!split.begun)
+		{
+			m_barriers.Transition(split.pResource, split.stateBefore, split.stateAfter, split.subresource, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+			split.begun = true;
+		}
+	}
+
+	m_barriers.Flush(pCommandList);
+}
+
+UINT ResourceStateTracker::FlushPendingResourceBarriers(ID3D12GraphicsCommandList* pCommandList)
+{
+	BarrierBatcher resolvedBarriers;
+
+	for (const D3D12_RESOURCE_BARRIER& pending : m_pendingBarriers)
+	{
+		ID3D12Resource* pResource = pending.Transition.pResource;
+		const UINT subresource = pending.Transition.Subresource;
+		const D3D12_RESOURCE_STATES stateAfter = pending.Transition.StateAfter;
+
+		// every resource has to be registered, otherwise its state is anyone's guess
+		auto found = g_globalStates.find(pResource);
+		if (found == g_globalStates.end())
+		{
+			throw HrException(E_INVALIDARG);
+		}
+		GlobalResourceState& globalState = found->second;
+
+		if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !globalState.subresourceStates.empty())
+		{
+			for (UINT i = 0; i < globalState.subresourceCount; i++)
+			{
+				auto subresourceState = globalState.subresourceStates.find(i);
+				const D3D12_RESOURCE_STATES stateBefore = subresourceState != globalState.subresourceStates.end() ? subresourceState->second : globalState.state;
+				if (stateBefore != stateAfter)
+				{
+					resolvedBarriers.Transition(pResource, stateBefore, stateAfter, i);
+				}
+			}
+		}
+		else
+		{
+			auto subresourceState = globalState.subresourceStates.find(subresource);
+			const D3D12_RESOURCE_STATES stateBefore = subresourceState != globalState.subresourceStates.end() ? subresourceState->second : globalState.state;
+			if (stateBefore != stateAfter)
+			{
+				resolvedBarriers.Transition(pResource, stateBefore, stateAfter, subresource);
+			}
+		}
+	}
+
+	m_pendingBarriers.clear();
+	resolvedBarriers.Flush(pCommandList);
+	return static_cast<UINT>(resolvedBarriers.GetEmittedCount());
+}
+
+void ResourceStateTracker::CommitFinalResourceStates()
+{
+	// the lists were closed with transitions still open, EndSplitTransitions() was never called
+	if (!m_openSplitTransitions.empty())
+	{
+		throw HrException(E_ILLEGAL_METHOD_CALL);
+	}
+
+	for (const auto& finalState : m_finalStates)
+	{
+		auto found = g_globalStates.find(finalState.first);
+		if (found == g_globalStates.end())
+		{
+			continue;
+		}
+		GlobalResourceState& globalState = found->second;
+
+		// subresources the list never touched keep their state
+		if (finalState.second.state != UnknownState)
+		{
+			globalState.state = finalState.second.state;
+			globalState.subresourceStates.clear();
+		}
+		for (const auto& subresourceState : finalState.second.subresourceStates)
+		{
+			globalState.subresourceStates[subresourceState.first] = subresourceState.second;
+		}
+	}
+
+	m_finalStates.clear();
+}
+
+void ResourceStateTracker::AddGlobalResourceState(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state)
+{
+	std::lock_guard<std::mutex> lock(g_globalMutex);
+
+	GlobalResourceState& globalState = g_globalStates[pResource];
+	globalState.state = state;
+	globalState.subresourceStates.clear();
+	globalState.subresourceCount = GetSubresourceCount(pResource);
+}
+
+void ResourceStateTracker::RemoveGlobalResourceState(ID3D12Resource* pResource)
+{
+	std::lock_guard<std::mutex> lock(g_globalMutex);
+	g_globalStates.erase(pResource);
+}
+
+std::unique_lock<std::mutex> ResourceStateTracker::LockGlobalState()
+{
+	return std::unique_lock<std::mutex>(g_globalMutex);
+}
+
+UINT ResourceStateTracker::GetSubresourceCount(ID3D12Resource* pResource)
+{
+	const CD3DX12_RESOURCE_DESC desc(pResource->GetDesc());
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return 1;
+	}
+
+	ComPtr<ID3D12Device> device;
+	ThrowIfFailed(pResource->GetDevice(IID_PPV_ARGS(&device)));
+	return desc.Subresources(device.Get());
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "BarrierBatcher.h"
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Keeps track of the state of every subresource so callers only say which state they
+// need a resource in, never which state it was in before.
+//
+// Every resource the app creates is registered with its initial state in a global
+// registry. While a command list is recorded, its tracker remembers the state each
+// subresource ends up in. The first transition of a subresource in a list can't know
+// its state yet, as lists submitted earlier may still change it, so it is kept as a
+// pending barrier. Right before the list is executed, FlushPendingResourceBarriers()
+// resolves the pending barriers against the registry into a small list that runs first,
+// and CommitFinalResourceStates() writes the list's final states back to the registry.
+//
+// BeginTransition() and EndTransition() split a transition into BEGIN_ONLY and END_ONLY
+// barriers, so the gpu can overlap the transition with the unrelated work recorded
+// between the two calls.
+//
+// One tracker records one command list, or a sequence of lists that are submitted
+// together in order, on one thread. Submission has to happen while the lock returned by
+// LockGlobalState() is held, so lists executed from several threads see a consistent registry.
+class ResourceStateTracker
+{
+public:
+	ResourceStateTracker();
+
+	// -- Recording -- //
+
+	// Queues whatever barrier puts the subresource, or all of them, into stateAfter.
+	void TransitionResource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	void TransitionSubresource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT mipSlice, UINT arraySlice, UINT planeSlice);
+
+	// Starts a split transition into stateAfter, which has to be ended with EndTransition() or
+	// EndSplitTransitions() before the resource is used in the new state. The BEGIN_ONLY half is
+	// recorded by the next flush; a transition that is ended before that, or whose state before
+	// isn't known yet, is recorded as a regular one.
+	void BeginTransition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	void EndTransition(ID3D12Resource* pResource, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	void EndSplitTransitions(); // ends every split transition still open, call this before closing the list
+
+	// Records the queued barriers, before the next draw, copy or clear and before closing the list.
+	void FlushResourceBarriers(ID3D12GraphicsCommandList* pCommandList);
+
+	// -- Submission -- //
+
+	// Records the barriers that bring the registry's states to the ones the list expects, and
+	// returns how many there were. The list must be executed right before the tracked ones.
+	UINT FlushPendingResourceBarriers(ID3D12GraphicsCommandList* pCommandList);
+
+	// Writes the final states of the tracked lists to the registry once they are executed,
+	// and starts over for the next recording. Every split transition has to be ended by then,
+	// a begun one that never ended leaves the resource in no defined state and throws.
+	void CommitFinalResourceStates();
+
+	const BarrierBatcher& GetBarriers() const { return m_barriers; }
+
+	// -- Registry -- //
+
+	static void AddGlobalResourceState(ID3D12Resource* pResource, D3D12_RESOURCE_STATES state);
+	static void RemoveGlobalResourceState(ID3D12Resource* pResource);
+	static std::unique_lock<std::mutex> LockGlobalState(); // held from resolving the pending barriers until the final states are committed
+
+private:
+	// marks a subresource whose state isn't known to this tracker
+	static const D3D12_RESOURCE_STATES UnknownState = static_cast<D3D12_RESOURCE_STATES>(-1);
+
+	// the state of every subresource of one resource, the ones without an entry are in state
+	struct ResourceState
+	{
+		ResourceState() : state(UnknownState) {}
+
+		D3D12_RESOURCE_STATES Get(UINT subresource) const;
+		void Set(UINT subresource, D3D12_RESOURCE_STATES newState);
+
+		D3D12_RESOURCE_STATES state;
+		std::map<UINT, D3D12_RESOURCE_STATES> subresourceStates;
+	};
+
+	struct SplitTransition
+	{
+		ID3D12Resource* pResource;
+		UINT subresource;
+		D3D12_RESOURCE_STATES stateBefore;
+		D3D12_RESOURCE_STATES stateAfter;
+		bool begun; // the BEGIN_ONLY half has been recorded
+	};
+
+	void AddTransition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateAfter, UINT subresource, bool split);
+	static UINT GetSubresourceCount(ID3D12Resource* pResource);
+
+	BarrierBatcher m_barriers;
+	std::vector<D3D12_RESOURCE_BARRIER> m_pendingBarriers; // first transitions, the state before them is resolved on submission
+	std::map<ID3D12Resource*, ResourceState> m_finalStates; // the state the recorded commands leave each resource in
+	std::vector<SplitTransition> m_openSplitTransitions;
+};
@@ -0,0 +1,126 @@
+#include "stdafx.h"
+#include "RingAllocator.h"
+
+namespace
+{
+	inline UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+RingAllocator::RingAllocator(ID3D12Fence* pFence, UINT64 size) :
+	m_fence(pFence),
+	m_fenceEvent(nullptr),
+	m_size(size),
+	m_head(0),
+	m_tail(0),
+	m_allocatedSize(0),
+	m_freedSize(0)
+{
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_fenceEvent == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+RingAllocator::~RingAllocator()
+{
+	CloseHandle(m_fenceEvent);
+}
+
+UINT64 RingAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+	if (size > m_size)
+	{
+		throw HrException(E_OUTOFMEMORY);
+	}
+
+	UINT64 offset;
+	while (!TryAllocate(size, alignment, &offset))
+	{
+		// The ring is full. Only submitted allocations can ever be given back,
+		// so if there are none the caller has to submit its work first.
+		if (m_submissions.empty())
+		{
+			throw HrException(E_OUTOFMEMORY);
+		}
+
+		// wait for the oldest submission to retire and try again
+		const UINT64 fenceValue = m_submissions.front().fenceValue;
+		if (m_fence->GetCompletedValue() < fenceValue)
+		{
+			ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+			WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+		}
+		Reclaim(fenceValue);
+	}
+	return offset;
+}
+
+bool RingAllocator::TryAllocate(UINT64 size, UINT64 alignment, UINT64* pOffset)
+{
+	Reclaim(m_fence->GetCompletedValue());
+
+	if (GetUsedSize() == 0)
+	{
+		// nothing is in use, start over at the beginning to keep the largest block free
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	// an allocation has to be contiguous, so it can't straddle the end of the ring
+	UINT64 offset = AlignUp(m_head, alignment);
+	UINT64 padding = offset - m_head;
+	if (m_head > m_tail || GetUsedSize() == 0)
+	{
+		// the free space is [head, size) followed by [0, tail)
+		if (offset + size > m_size)
+		{
+			// doesn't fit at the end, skip the rest of the ring and wrap around
+			if (size > m_tail)
+			{
+				return false;
+			}
+			offset = 0;
+			padding = m_size - m_head;
+		}
+	}
+	else if (offset + size > m_tail)
+	{
+		// the free space is [head, tail), or nothing when the ring is full
+		return false;
+	}
+
+	m_head = offset + size;
+	m_allocatedSize += padding + size;
+	*pOffset = offset;
+	return true;
+}
+
+void RingAllocator::Submit(UINT64 fenceValue)
+{
+	// nothing new was allocated since the last submission
+	const UINT64 submittedSize = m_submissions.empty() ? m_freedSize : m_submissions.back().allocatedSize;
+	if (submittedSize == m_allocatedSize)
+	{
+		return;
+	}
+
+	Submission submission;
+	submission.fenceValue = fenceValue;
+	submission.head = m_head;
+	submission.allocatedSize = m_allocatedSize;
+	m_submissions.push_back(submission);
+}
+
+void RingAllocator::Reclaim(UINT64 completedFenceValue)
+{
+	while (!m_submissions.empty() && m_submissions.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_submissions.front().head;
+		m_freedSize = m_submissions.front().allocatedSize;
+		m_submissions.pop_front();
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <deque>
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// The bookkeeping shared by the rings that are retired against a fence, in whatever units
+// the owner hands out: bytes of an upload buffer or descriptors of a heap. Ranges are
+// allocated contiguously at the head; Submit() tags everything allocated since the last
+// call with the fence value signaled after the lists using it, and the range is given back
+// when the fence reaches that value. The owner turns the offsets into addresses.
+class RingAllocator
+{
+public:
+	RingAllocator(ID3D12Fence* pFence, UINT64 size);
+	~RingAllocator();
+
+	// Allocates size contiguous units, waiting for the gpu to retire older submissions if the ring is full.
+	UINT64 Allocate(UINT64 size, UINT64 alignment);
+
+	// Same as Allocate() but never waits, returns false when the space isn't free yet.
+	bool TryAllocate(UINT64 size, UINT64 alignment, UINT64* pOffset);
+
+	// Marks every allocation made since the last call as in use until the fence reaches fenceValue.
+	void Submit(UINT64 fenceValue);
+
+	// Gives back the space of every submission the gpu has finished with.
+	void Reclaim(UINT64 completedFenceValue);
+
+	UINT64 GetSize() const { return m_size; }
+	UINT64 GetUsedSize() const { return m_allocatedSize - m_freedSize; }
+
+private:
+	// a group of allocations the gpu is using until the fence reaches fenceValue
+	struct Submission
+	{
+		UINT64 fenceValue;
+		UINT64 head; // head of the ring when the submission was made, everything before it is released with it
+		UINT64 allocatedSize; // value of m_allocatedSize when the submission was made
+	};
+
+	ComPtr<ID3D12Fence> m_fence;
+	HANDLE m_fenceEvent;
+
+	UINT64 m_size;
+	UINT64 m_head; // next free unit
+	UINT64 m_tail; // oldest unit still in use
+	UINT64 m_allocatedSize; // total units handed out, including alignment padding and space skipped when wrapping
+	UINT64 m_freedSize; // total units given back
+	std::deque<Submission> m_submissions;
+};
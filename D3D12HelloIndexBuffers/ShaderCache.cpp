@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <vector>
+#include <winver.h> // GetFileVersionInfo
+
+namespace
+{
+	// writes the compiler output to the debugger before failing
+	void ThrowIfCompileFailed(HRESULT hr, ID3DBlob* pErrors)
+	{
+		if (FAILED(hr) && pErrors)
+		{
+			OutputDebugStringA(static_cast<const char*>(pErrors->GetBufferPointer()));
+		}
+		ThrowIfFailed(hr);
+	}
+
+	// Identifies the d3dcompiler dll the process loaded. D3D_COMPILER_VERSION only names the
+	// dll (47), the file version changes with every compiler update. A dll without version
+	// information is identified by the hash of its contents instead.
+	UINT64 GetCompilerVersion()
+	{
+		WCHAR modulePath[MAX_PATH];
+		const HMODULE compilerModule = GetModuleHandleW(D3DCOMPILER_DLL_W);
+		if (compilerModule == nullptr || GetModuleFileNameW(compilerModule, modulePath, MAX_PATH) == 0)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+
+		DWORD handle = 0;
+		std::vector<UINT8> versionInfo(GetFileVersionInfoSizeW(modulePath, &handle));
+		VS_FIXEDFILEINFO* pFileInfo = nullptr;
+		UINT fileInfoSize = 0;
+		if (!versionInfo.empty() &&
+			GetFileVersionInfoW(modulePath, 0, static_cast<DWORD>(versionInfo.size()), versionInfo.data()) &&
+			VerQueryValueW(versionInfo.data(), L"\\", reinterpret_cast<void**>(&pFileInfo), &fileInfoSize) &&
+			fileInfoSize >= sizeof(VS_FIXEDFILEINFO))
+		{
+			return (static_cast<UINT64>(pFileInfo->dwFileVersionMS) << 32) | pFileInfo->dwFileVersionLS;
+		}
+
+		MappedFile compilerFile;
+		if (!compilerFile.Open(modulePath))
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+		}
+		Hasher hasher;
+		hasher.Add(compilerFile.GetData(), compilerFile.GetSize());
+		return hasher.GetValue();
+	}
+}
+
+ShaderCache::ShaderCache(LPCWSTR directory) :
+	m_directory(directory),
+	m_compilerVersion(GetCompilerVersion()),
+	m_hitCount(0),
+	m_missCount(0)
+{
+	if (!CreateDirectoryW(directory, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+ComPtr<ID3DBlob> ShaderCache::CompileFromFile(LPCWSTR fileName, const D3D_SHADER_MACRO* pDefines, LPCSTR entryPoint, LPCSTR target, UINT flags)
+{
+	// -- Build the key -- //
+
+	MappedFile sourceFile;
+	if (!sourceFile.Open(fileName))
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+
+	// the preprocessor needs a narrow source name to resolve relative includes
+	char sourceName[MAX_PATH];
+	WideCharToMultiByte(CP_UTF8, 0, fileName, -1, sourceName, MAX_PATH, nullptr, nullptr);
+
+	// Preprocessing expands every include and define, so a change to any included
+	// file or to the defines changes the key. This is much cheaper than compiling.
+	ComPtr<ID3DBlob> preprocessed;
+	ComPtr<ID3DBlob> errors;
+	ThrowIfCompileFailed(D3DPreprocess(sourceFile.GetData(), sourceFile.GetSize(), sourceName, pDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, &preprocessed, &errors), errors.Get());
+	sourceFile.Close();
+
+	Hasher hasher;
+	hasher.Add(preprocessed->GetBufferPointer(), preprocessed->GetBufferSize());
+	hasher.AddString(entryPoint);
+	hasher.AddString(target);
+	hasher.AddValue(flags);
+	hasher.AddValue(m_compilerVersion);
+
+	WCHAR key[17];
+	swprintf_s(key, L"%016llX", hasher.GetValue());
+	const std::wstring cacheFileName = m_directory + L"\\" + key + L".cso";
+
+	// -- Cache hit -- //
+
+	MappedFile cacheFile;
+	if (cacheFile.Open(cacheFileName.c_str()))
+	{
+		ComPtr<ID3DBlob> bytecode;
+		ThrowIfFailed(D3DCreateBlob(cacheFile.GetSize(), &bytecode));
+		memcpy(bytecode->GetBufferPointer(), cacheFile.GetData(), cacheFile.GetSize());
+		m_hitCount++;
+		return bytecode;
+	}
+
+	// -- Cache miss -- //
+
+	// compile from the original file rather than the preprocessed text so debug info keeps pointing at the real sources
+	ComPtr<ID3DBlob> bytecode;
+	ThrowIfCompileFailed(D3DCompileFromFile(fileName, pDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, target, flags, 0, &bytecode, &errors), errors.Get());
+	m_missCount++;
+
+	// failing to write the entry only means it gets compiled again next time
+	WriteFileAtomic(cacheFileName.c_str(), bytecode->GetBufferPointer(), bytecode->GetBufferSize());
+
+	return bytecode;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "DXSampleHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Content addressed cache for shaders compiled at runtime. The key is a hash of the
+// preprocessed source (so every included file and define is part of it), the entry
+// point, the target profile, the compile flags and the file version of the d3dcompiler
+// dll actually loaded, so a compiler update invalidates every entry. Bytecode is stored
+// on disk under that key, and a hit skips D3DCompileFromFile entirely.
+// CompileFromFile() may be called from several threads at once.
+class ShaderCache
+{
+public:
+	// directory is created if it doesn't exist yet
+	explicit ShaderCache(LPCWSTR directory);
+
+	// Same as D3DCompileFromFile with the standard file include handler.
+	ComPtr<ID3DBlob> CompileFromFile(LPCWSTR fileName, const D3D_SHADER_MACRO* pDefines, LPCSTR entryPoint, LPCSTR target, UINT flags);
+
+	UINT GetHitCount() const { return m_hitCount; }
+	UINT GetMissCount() const { return m_missCount; }
+
+private:
+	std::wstring m_directory;
+	UINT64 m_compilerVersion; // file version of the loaded d3dcompiler dll, or a hash of it
+	std::atomic<UINT> m_hitCount;
+	std::atomic<UINT> m_missCount;
+};
@@ -0,0 +1,287 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+	// vertex positions are snapped to 1/16th of a pixel, like the sub-pixel grid of real hardware
+	const float SubPixelScale = 16.0f;
+
+	inline float SnapToSubPixel(float v)
+	{
+		return std::floor(v * SubPixelScale + 0.5f) / SubPixelScale;
+	}
+
+	// converts 4 pixels worth of [0, 1] float channels into packed R8G8B8A8_UNORM
+	inline __m128i PackUnorm8(__m128 r, __m128 g, __m128 b, __m128 a)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(255.0f);
+
+		__m128i ri = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), one), scale));
+		__m128i gi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), one), scale));
+		__m128i bi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), one), scale));
+		__m128i ai = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(a, zero), one), scale));
+
+		return _mm_or_si128(_mm_or_si128(ri, _mm_slli_epi32(gi, 8)), _mm_or_si128(_mm_slli_epi32(bi, 16), _mm_slli_epi32(ai, 24)));
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(uint32_t width, uint32_t height) :
+	m_width(width),
+	m_height(height),
+	m_rowPitch((width + 3) & ~3u),
+	m_renderTarget(static_cast<size_t>((width + 3) & ~3u) * height),
+	m_inputLayout{},
+	m_pVertexData(nullptr),
+	m_vertexDataSize(0),
+	m_pInstanceData(nullptr),
+	m_instanceDataSize(0),
+	m_pIndexData(nullptr),
+	m_indexCount(0),
+	m_viewport{ 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height) },
+	m_scissorRect{ 0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height) },
+	m_sceneConstants{}
+{
+}
+
+void SoftwareRasterizer::SetVertexBuffer(const void* pData, uint32_t sizeInBytes)
+{
+	m_pVertexData = static_cast<const uint8_t*>(pData);
+	m_vertexDataSize = sizeInBytes;
+}
+
+void SoftwareRasterizer::SetInstanceBuffer(const void* pData, uint32_t sizeInBytes)
+{
+	m_pInstanceData = static_cast<const uint8_t*>(pData);
+	m_instanceDataSize = sizeInBytes;
+}
+
+void SoftwareRasterizer::SetIndexBuffer(const uint32_t* pData, uint32_t sizeInBytes)
+{
+	m_pIndexData = pData;
+	m_indexCount = sizeInBytes / sizeof(uint32_t);
+}
+
+void SoftwareRasterizer::ClearRenderTarget(const float color[4])
+{
+	__m128i packed = PackUnorm8(_mm_set1_ps(color[0]), _mm_set1_ps(color[1]), _mm_set1_ps(color[2]), _mm_set1_ps(color[3]));
+
+	uint32_t* pPixels = m_renderTarget.data();
+	const size_t pixelCount = m_renderTarget.size(); // always a multiple of 4 because of the row pitch
+	for (size_t i = 0; i < pixelCount; i += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + i), packed);
+	}
+}
+
+void SoftwareRasterizer::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation)
+{
+	if (m_pIndexData == nullptr || m_pVertexData == nullptr || m_inputLayout.strideInBytes == 0)
+	{
+		return;
+	}
+
+	// out of range index reads return 0 on the GPU, here we just clamp the draw to the bound data
+	const uint32_t endIndex = std::min(startIndexLocation + indexCountPerInstance, m_indexCount);
+	const uint32_t vertexCount = m_vertexDataSize / m_inputLayout.strideInBytes;
+	if (m_pInstanceData != nullptr && m_inputLayout.instanceStrideInBytes != 0)
+	{
+		const uint32_t availableInstanceCount = m_instanceDataSize / m_inputLayout.instanceStrideInBytes;
+		instanceCount = startInstanceLocation < availableInstanceCount ? std::min(instanceCount, availableInstanceCount - startInstanceLocation) : 0;
+	}
+
+	for (uint32_t instance = startInstanceLocation; instance < startInstanceLocation + instanceCount; instance++)
+	{
+		for (uint32_t i = startIndexLocation; i + 2 < endIndex; i += 3)
+		{
+			ShadedVertex v[3];
+			bool valid = true;
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const int64_t index = static_cast<int64_t>(m_pIndexData[i + corner]) + baseVertexLocation;
+				if (index < 0 || index >= vertexCount)
+				{
+					valid = false;
+					break;
+				}
+				ShadeVertex(static_cast<uint32_t>(index), instance, &v[corner]);
+			}
+
+			if (valid)
+			{
+				RasterizeTriangle(v[0], v[1], v[2]);
+			}
+		}
+	}
+}
+
+// emulates VSMain (the position is transformed by the instance and offset, the color is tinted
+// by the instance) followed by the viewport transform
+void SoftwareRasterizer::ShadeVertex(uint32_t index, uint32_t instance, ShadedVertex* pOut) const
+{
+	const uint8_t* pVertex = m_pVertexData + static_cast<size_t>(index) * m_inputLayout.strideInBytes;
+
+	float position[3];
+	memcpy(position, pVertex + m_inputLayout.positionOffset, sizeof(position));
+	memcpy(pOut->color, pVertex + m_inputLayout.colorOffset, sizeof(pOut->color));
+
+	if (m_pInstanceData != nullptr && m_inputLayout.instanceStrideInBytes != 0)
+	{
+		const uint8_t* pInstance = m_pInstanceData + static_cast<size_t>(instance) * m_inputLayout.instanceStrideInBytes;
+
+		float transform[4];
+		uint32_t color;
+		memcpy(transform, pInstance + m_inputLayout.instanceTransformOffset, sizeof(transform));
+		memcpy(&color, pInstance + m_inputLayout.instanceColorOffset, sizeof(color));
+
+		position[0] = position[0] * transform[0] + transform[2];
+		position[1] = position[1] * transform[1] + transform[3];
+		for (uint32_t channel = 0; channel < 4; channel++)
+		{
+			pOut->color[channel] *= ((color >> (channel * 8)) & 0xff) / 255.0f;
+		}
+	}
+
+	// POSITION is R32G32B32_FLOAT, so the input w is 1
+	const float* offset = m_sceneConstants.offset;
+	const float invW = 1.0f / (1.0f + offset[3]);
+	const float x = (position[0] + offset[0]) * invW;
+	const float y = (position[1] + offset[1]) * invW;
+
+	pOut->x = SnapToSubPixel(m_viewport.topLeftX + (x + 1.0f) * 0.5f * m_viewport.width);
+	pOut->y = SnapToSubPixel(m_viewport.topLeftY + (1.0f - y) * 0.5f * m_viewport.height);
+}
+
+// Rasterizes one triangle with edge functions, evaluating 4 horizontally adjacent pixels per step.
+// Uses the default rasterizer state: solid fill, back face culling, clockwise front faces and the
+// top-left fill rule. Colors are interpolated linearly in screen space, which is exact as long as
+// all vertices share the same w, as they do in this sample.
+void SoftwareRasterizer::RasterizeTriangle(const ShadedVertex& v0, const ShadedVertex& v1, const ShadedVertex& v2)
+{
+	// twice the signed area, positive for clockwise triangles in render target space (y pointing down)
+	const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (!(area > 0.0f))
+	{
+		return; // back facing or degenerate
+	}
+
+	// pixel bounds, clipped against the scissor rect and the render target
+	const int32_t clipLeft = std::max(m_scissorRect.left, 0);
+	const int32_t clipTop = std::max(m_scissorRect.top, 0);
+	const int32_t clipRight = std::min(m_scissorRect.right, static_cast<int32_t>(m_width));
+	const int32_t clipBottom = std::min(m_scissorRect.bottom, static_cast<int32_t>(m_height));
+
+	const float minX = std::min(v0.x, std::min(v1.x, v2.x));
+	const float maxX = std::max(v0.x, std::max(v1.x, v2.x));
+	const float minY = std::min(v0.y, std::min(v1.y, v2.y));
+	const float maxY = std::max(v0.y, std::max(v1.y, v2.y));
+
+	// a pixel is covered when its center is inside, so round the bounds to the enclosed pixel centers
+	const int32_t left = std::max(clipLeft, static_cast<int32_t>(std::floor(minX)));
+	const int32_t top = std::max(clipTop, static_cast<int32_t>(std::floor(minY)));
+	const int32_t right = std::min(clipRight, static_cast<int32_t>(std::ceil(maxX)));
+	const int32_t bottom = std::min(clipBottom, static_cast<int32_t>(std::ceil(maxY)));
+	if (left >= right || top >= bottom)
+	{
+		return;
+	}
+
+	// edge function E(x, y) = A * x + B * y + C for the edge opposite to each vertex
+	const ShadedVertex* pVerts[3] = { &v0, &v1, &v2 };
+	float edgeA[3], edgeB[3], edgeC[3];
+	bool topLeft[3];
+	for (int e = 0; e < 3; e++)
+	{
+		const ShadedVertex& a = *pVerts[(e + 1) % 3];
+		const ShadedVertex& b = *pVerts[(e + 2) % 3];
+		edgeA[e] = a.y - b.y;
+		edgeB[e] = b.x - a.x;
+		edgeC[e] = a.x * b.y - a.y * b.x;
+
+		// left edges go up, top edges are horizontal and go right
+		topLeft[e] = edgeA[e] > 0.0f || (edgeA[e] == 0.0f && edgeB[e] > 0.0f);
+	}
+
+	// walk the rows in aligned blocks of 4 pixels, the row pitch guarantees a block never crosses a row
+	const int32_t alignedLeft = left & ~3;
+	const __m128i laneOffsets = _mm_set_epi32(3, 2, 1, 0);
+	const __m128i leftBound = _mm_set1_epi32(left);
+	const __m128i rightBound = _mm_set1_epi32(right);
+
+	const float invArea = 1.0f / area;
+	const __m128 pixelOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 stepX[3], topLeftMask[3];
+	for (int e = 0; e < 3; e++)
+	{
+		stepX[e] = _mm_set1_ps(edgeA[e] * 4.0f);
+		topLeftMask[e] = _mm_castsi128_ps(_mm_set1_epi32(topLeft[e] ? -1 : 0));
+	}
+
+	// per vertex colors pre-scaled by 1 / area so the edge functions act as barycentric weights
+	__m128 color[3][4];
+	for (int v = 0; v < 3; v++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			color[v][c] = _mm_set1_ps(pVerts[v]->color[c] * invArea);
+		}
+	}
+
+	for (int32_t y = top; y < bottom; y++)
+	{
+		const float centerY = static_cast<float>(y) + 0.5f;
+		const __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(alignedLeft) + 0.5f), pixelOffsets);
+
+		__m128 w[3];
+		for (int e = 0; e < 3; e++)
+		{
+			w[e] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[e]), centerX), _mm_set1_ps(edgeB[e] * centerY + edgeC[e]));
+		}
+
+		uint32_t* pRow = m_renderTarget.data() + static_cast<size_t>(y) * m_rowPitch;
+		for (int32_t x = alignedLeft; x < right; x += 4)
+		{
+			// inside when every edge is positive, or zero on a top or left edge
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int e = 0; e < 3; e++)
+			{
+				__m128 edgeInside = _mm_or_ps(_mm_cmpgt_ps(w[e], zero), _mm_and_ps(_mm_cmpeq_ps(w[e], zero), topLeftMask[e]));
+				inside = _mm_and_ps(inside, edgeInside);
+			}
+
+			// mask off the pixels outside of the bounds, they may still be inside the triangle when the scissor rect clips it
+			__m128i lanes = _mm_add_epi32(_mm_set1_epi32(x), laneOffsets);
+			__m128i inBounds = _mm_andnot_si128(_mm_cmplt_epi32(lanes, leftBound), _mm_cmplt_epi32(lanes, rightBound));
+			inside = _mm_and_ps(inside, _mm_castsi128_ps(inBounds));
+
+			const int mask = _mm_movemask_ps(inside);
+			if (mask != 0)
+			{
+				// emulates PSMain, the pixel color is the interpolated vertex color
+				__m128 channel[4];
+				for (int c = 0; c < 4; c++)
+				{
+					channel[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w[0], color[0][c]), _mm_mul_ps(w[1], color[1][c])), _mm_mul_ps(w[2], color[2][c]));
+				}
+				__m128i pixels = PackUnorm8(channel[0], channel[1], channel[2], channel[3]);
+
+				__m128i* pDest = reinterpret_cast<__m128i*>(pRow + x);
+				__m128i coverage = _mm_castps_si128(inside);
+				__m128i existing = _mm_loadu_si128(pDest);
+				_mm_storeu_si128(pDest, _mm_or_si128(_mm_and_si128(coverage, pixels), _mm_andnot_si128(coverage, existing)));
+			}
+
+			for (int e = 0; e < 3; e++)
+			{
+				w[e] = _mm_add_ps(w[e], stepX[e]);
+			}
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// A small CPU implementation of the fixed pipeline used by this sample, so the
+// OnInit/OnUpdate/OnRender/OnDestroy flow can run on machines without a GPU.
+// It mirrors the subset of D3D12 state the sample actually uses: one vertex
+// buffer, an optional per instance buffer, an index buffer, a viewport, a scissor rect and a single RGBA8 render
+// target. The vertex and pixel stages emulate VSMain/PSMain from shaders.hlsl
+// (position is passed through, color is interpolated and written out).
+//
+// This file only depends on the C++ standard library and SSE2 intrinsics so it
+// can be built outside of Windows as well.
+class SoftwareRasterizer
+{
+public:
+	// where POSITION (float3) and COLOR (float4) live inside one vertex, like the input layout of the pso
+	struct InputLayout
+	{
+		uint32_t strideInBytes;
+		uint32_t positionOffset;
+		uint32_t colorOffset;
+
+		// The second input slot, stepped once per instance: INSTANCETRANSFORM (float4, xy scale
+		// and zw offset of the position) and INSTANCECOLOR (R8G8B8A8_UNORM, multiplied with the
+		// vertex color). Without an instance buffer every instance is drawn untransformed.
+		uint32_t instanceStrideInBytes;
+		uint32_t instanceTransformOffset;
+		uint32_t instanceColorOffset;
+	};
+
+	struct Viewport
+	{
+		float topLeftX;
+		float topLeftY;
+		float width;
+		float height;
+	};
+
+	struct Rect
+	{
+		int32_t left;
+		int32_t top;
+		int32_t right;
+		int32_t bottom;
+	};
+
+	// contents of SceneConstantBuffer in shaders.hlsl
+	struct SceneConstants
+	{
+		float offset[4];
+	};
+
+	SoftwareRasterizer(uint32_t width, uint32_t height);
+
+	// Input assembler / rasterizer state
+	void SetInputLayout(const InputLayout& layout) { m_inputLayout = layout; }
+	void SetVertexBuffer(const void* pData, uint32_t sizeInBytes);
+	void SetInstanceBuffer(const void* pData, uint32_t sizeInBytes);
+	void SetIndexBuffer(const uint32_t* pData, uint32_t sizeInBytes);
+	void SetViewport(const Viewport& viewport) { m_viewport = viewport; }
+	void SetScissorRect(const Rect& rect) { m_scissorRect = rect; }
+	void SetSceneConstants(const SceneConstants& constants) { m_sceneConstants = constants; }
+
+	// Commands
+	void ClearRenderTarget(const float color[4]);
+	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation);
+
+	// Render target access (R8G8B8A8_UNORM, rows are GetRowPitch() pixels apart)
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+	uint32_t GetRowPitch() const { return m_rowPitch; }
+	const uint32_t* GetRenderTarget() const { return m_renderTarget.data(); }
+
+private:
+	// output of the emulated vertex shader, already in render target pixel space
+	struct ShadedVertex
+	{
+		float x, y;
+		float color[4];
+	};
+
+	void ShadeVertex(uint32_t index, uint32_t instance, ShadedVertex* pOut) const;
+	void RasterizeTriangle(const ShadedVertex& v0, const ShadedVertex& v1, const ShadedVertex& v2);
+
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_rowPitch; // width rounded up to a multiple of 4 so every row can be written 4 pixels at a time
+	std::vector<uint32_t> m_renderTarget;
+
+	InputLayout m_inputLayout;
+	const uint8_t* m_pVertexData;
+	uint32_t m_vertexDataSize;
+	const uint8_t* m_pInstanceData;
+	uint32_t m_instanceDataSize;
+	const uint32_t* m_pIndexData;
+	uint32_t m_indexCount;
+	Viewport m_viewport;
+	Rect m_scissorRect;
+	SceneConstants m_sceneConstants;
+};
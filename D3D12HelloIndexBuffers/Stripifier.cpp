@@ -0,0 +1,164 @@
+#include "Stripifier.h"
+
+namespace
+{
+	const uint32_t NoTriangle = 0xffffffff;
+	const uint32_t EmittedWalk = 0xffffffff; // m_visited of triangles already in a strip
+}
+
+const uint32_t Stripifier::RestartIndex;
+
+Stripifier::Stripifier(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount) :
+	m_pInput(pIndices),
+	m_walk(0),
+	m_stripCount(0)
+{
+	const uint32_t triangleCount = indexCount / 3;
+	m_visited.assign(triangleCount, 0);
+
+	// -- Vertex to triangle adjacency -- //
+
+	m_adjacencyOffsets.assign(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		m_adjacencyOffsets[pIndices[i] + 1]++;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		m_adjacencyOffsets[v + 1] += m_adjacencyOffsets[v];
+	}
+
+	m_adjacency.resize(triangleCount * 3);
+	std::vector<uint32_t> fill(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* pTriangle = pIndices + t * 3;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			m_adjacency[fill[pTriangle[corner]]++] = t;
+		}
+
+		// nothing to draw, and they would confuse the edge lookups
+		if (pTriangle[0] == pTriangle[1] || pTriangle[1] == pTriangle[2] || pTriangle[2] == pTriangle[0])
+		{
+			m_visited[t] = EmittedWalk;
+		}
+	}
+
+	// -- Grow the strips -- //
+
+	m_indices.reserve(indexCount);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		if (m_visited[t] == EmittedWalk)
+		{
+			continue;
+		}
+
+		// Which edge the strip leaves the first triangle by decides the direction it grows in,
+		// so try all of them on a dry run and keep the longest. Even starts win ties, they
+		// don't need the degenerate triangle.
+		Start best = { t, 0, false };
+		uint32_t bestLength = 0;
+		for (uint32_t odd = 0; odd < 2; odd++)
+		{
+			for (uint32_t rotation = 0; rotation < 3; rotation++)
+			{
+				const Start start = { t, rotation, odd != 0 };
+				const uint32_t length = WalkStrip(start, false);
+				if (length > bestLength)
+				{
+					best = start;
+					bestLength = length;
+				}
+			}
+		}
+
+		if (!m_indices.empty())
+		{
+			m_indices.push_back(RestartIndex);
+		}
+		WalkStrip(best, true);
+		m_stripCount++;
+	}
+}
+
+// Looks for a triangle not taken yet with the directed edge from -> to. Returns it and
+// its remaining vertex, or NoTriangle.
+uint32_t Stripifier::FindTriangle(uint32_t from, uint32_t to, uint32_t& third) const
+{
+	for (uint32_t i = m_adjacencyOffsets[from]; i < m_adjacencyOffsets[from + 1]; i++)
+	{
+		const uint32_t t = m_adjacency[i];
+		if (m_visited[t] == EmittedWalk || m_visited[t] == m_walk)
+		{
+			continue;
+		}
+
+		const uint32_t* pTriangle = m_pInput + t * 3;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			if (pTriangle[corner] == from && pTriangle[(corner + 1) % 3] == to)
+			{
+				third = pTriangle[(corner + 2) % 3];
+				return t;
+			}
+		}
+	}
+	return NoTriangle;
+}
+
+// Follows the strip from the start triangle as far as it goes and returns its length in
+// triangles. Only a walk with emit set writes the indices and uses up the triangles.
+uint32_t Stripifier::WalkStrip(const Start& start, bool emit)
+{
+	m_walk++;
+	const uint32_t visited = emit ? EmittedWalk : m_walk;
+
+	const uint32_t* pTriangle = m_pInput + start.triangle * 3;
+	const uint32_t x = pTriangle[start.rotation];
+	const uint32_t y = pTriangle[(start.rotation + 1) % 3];
+	const uint32_t z = pTriangle[(start.rotation + 2) % 3];
+	m_visited[start.triangle] = visited;
+
+	// Strip triangle k is (s[k], s[k + 1], s[k + 2]) when k is even and (s[k + 1], s[k], s[k + 2])
+	// when it is odd. An odd start repeats y, so (x, y, z) is triangle 1 after a degenerate one.
+	uint32_t a = start.odd ? x : y; // the last two strip indices
+	uint32_t b = z;
+	bool nextOdd = !start.odd;
+	if (emit)
+	{
+		if (start.odd)
+		{
+			m_indices.insert(m_indices.end(), { y, y, x, z });
+		}
+		else
+		{
+			m_indices.insert(m_indices.end(), { x, y, z });
+		}
+	}
+
+	uint32_t length = 1;
+	for (;;)
+	{
+		// the next triangle has to share the last edge with the winding its position in the strip gives it
+		uint32_t third = 0;
+		const uint32_t t = nextOdd ? FindTriangle(b, a, third) : FindTriangle(a, b, third);
+		if (t == NoTriangle)
+		{
+			break;
+		}
+
+		m_visited[t] = visited;
+		if (emit)
+		{
+			m_indices.push_back(third);
+		}
+		a = b;
+		b = third;
+		nextOdd = !nextOdd;
+		length++;
+	}
+
+	return length;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Converts an indexed triangle list into triangle strips joined by restart indices, for
+// D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP with primitive restart. A strip of n triangles takes
+// n + 2 indices instead of 3n, so grid-like meshes shrink by close to 3 times.
+//
+// Strips are grown greedily across shared edges, starting from the first triangle not used
+// yet so the order of the list (for example from the MeshOptimizer) is mostly kept. The
+// winding of every triangle is preserved, a strip that has to start on an odd triangle
+// begins with one degenerate triangle. Triangles that repeat a vertex are dropped.
+//
+// Like the software rasterizer this only depends on the C++ standard library.
+class Stripifier
+{
+public:
+	// matches D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF, narrowing the indices to 16 bits turns it into 0xffff
+	static const uint32_t RestartIndex = 0xffffffff;
+
+	Stripifier(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+	const std::vector<uint32_t>& GetIndices() const { return m_indices; } // strips separated by RestartIndex
+	uint32_t GetIndexCount() const { return static_cast<uint32_t>(m_indices.size()); }
+	uint32_t GetStripCount() const { return m_stripCount; }
+
+private:
+	// a triangle with the order its vertices are walked in
+	struct Start
+	{
+		uint32_t triangle;
+		uint32_t rotation; // which corner comes first
+		bool odd; // enter the strip on an odd triangle
+	};
+
+	uint32_t FindTriangle(uint32_t from, uint32_t to, uint32_t& third) const;
+	uint32_t WalkStrip(const Start& start, bool emit);
+
+	const uint32_t* m_pInput;
+	std::vector<uint32_t> m_adjacencyOffsets; // triangles of each vertex, 3 per triangle
+	std::vector<uint32_t> m_adjacency;
+	std::vector<uint32_t> m_visited; // walk a triangle was last taken by, all ones for triangles already emitted
+	uint32_t m_walk;
+
+	std::vector<uint32_t> m_indices;
+	uint32_t m_stripCount;
+};
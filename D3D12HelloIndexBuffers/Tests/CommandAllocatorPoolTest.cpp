@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "CommandAllocatorPool.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	class StandInCommandAllocator : public DeviceChildStandIn<ID3D12CommandAllocator>
+	{
+	public:
+		explicit StandInCommandAllocator(D3D12_COMMAND_LIST_TYPE type) : m_type(type), m_resetCount(0) {}
+
+		HRESULT STDMETHODCALLTYPE Reset() override
+		{
+			m_resetCount++;
+			return S_OK;
+		}
+
+		D3D12_COMMAND_LIST_TYPE GetType() const { return m_type; }
+		UINT GetResetCount() const { return m_resetCount; }
+
+	private:
+		D3D12_COMMAND_LIST_TYPE m_type;
+		UINT m_resetCount;
+	};
+
+	// hands out stand-ins, so the pool runs without a device
+	class StandInCommandAllocatorPool : public CommandAllocatorPool
+	{
+	public:
+		explicit StandInCommandAllocatorPool(UINT64 maxRetainedCommandCount = DefaultMaxRetainedCommandCount) :
+			CommandAllocatorPool(nullptr, maxRetainedCommandCount)
+		{
+		}
+
+	protected:
+		ComPtr<ID3D12CommandAllocator> CreateAllocator(D3D12_COMMAND_LIST_TYPE type) override
+		{
+			return ComPtr<ID3D12CommandAllocator>(new StandInCommandAllocator(type));
+		}
+	};
+
+	StandInCommandAllocator* AsStandIn(const ComPtr<ID3D12CommandAllocator>& allocator)
+	{
+		return static_cast<StandInCommandAllocator*>(allocator.Get());
+	}
+
+	// an allocator only comes back once the fence passed the value it was released with,
+	// and the oldest retired allocator comes back first
+	void TestFenceGatedReuse()
+	{
+		StandInCommandAllocatorPool pool;
+		const D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+		ComPtr<ID3D12CommandAllocator> first = pool.Acquire(type, 0);
+		ComPtr<ID3D12CommandAllocator> second = pool.Acquire(type, 0);
+		CHECK(first != second);
+		CHECK(AsStandIn(first)->GetType() == type);
+		pool.Release(type, first.Get(), 1, 10);
+		pool.Release(type, second.Get(), 2, 10);
+
+		// the gpu hasn't reached either fence value yet
+		ComPtr<ID3D12CommandAllocator> third = pool.Acquire(type, 0);
+		CHECK(third != first && third != second);
+		CHECK(pool.GetCreatedCount() == 3);
+
+		// only the first one is done
+		CHECK(pool.Acquire(type, 1) == first);
+		CHECK(AsStandIn(first)->GetResetCount() == 1);
+		ComPtr<ID3D12CommandAllocator> fourth = pool.Acquire(type, 1);
+		CHECK(fourth != second);
+		CHECK(pool.GetCreatedCount() == 4);
+
+		CHECK(pool.Acquire(type, 2) == second);
+		CHECK(AsStandIn(second)->GetResetCount() == 1);
+		CHECK(pool.GetCreatedCount() == 4);
+	}
+
+	// every type has its own queue, in release order, so a pending allocator of one type
+	// never holds back another type
+	void TestReleaseOrderPerType()
+	{
+		StandInCommandAllocatorPool pool;
+
+		ComPtr<ID3D12CommandAllocator> direct = pool.Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, 0);
+		ComPtr<ID3D12CommandAllocator> copy = pool.Acquire(D3D12_COMMAND_LIST_TYPE_COPY, 0);
+		CHECK(AsStandIn(copy)->GetType() == D3D12_COMMAND_LIST_TYPE_COPY);
+		pool.Release(D3D12_COMMAND_LIST_TYPE_DIRECT, direct.Get(), 5, 10);
+		pool.Release(D3D12_COMMAND_LIST_TYPE_COPY, copy.Get(), 1, 10);
+
+		CHECK(pool.Acquire(D3D12_COMMAND_LIST_TYPE_COPY, 1) == copy);
+		CHECK(pool.Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, 1) != direct);
+		CHECK(pool.Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, 5) == direct);
+
+		// an allocator never comes back as another type
+		ComPtr<ID3D12CommandAllocator> compute = pool.Acquire(D3D12_COMMAND_LIST_TYPE_COMPUTE, 5);
+		CHECK(compute != direct && compute != copy);
+		CHECK(AsStandIn(compute)->GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+	}
+
+	// allocators that held more than maxRetainedCommandCount commands are let go once retired
+	void TestDiscardAboveMaxRetained()
+	{
+		StandInCommandAllocatorPool pool(100);
+		const D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+		ComPtr<ID3D12CommandAllocator> atLimit = pool.Acquire(type, 0);
+		ComPtr<ID3D12CommandAllocator> overLimit = pool.Acquire(type, 0);
+		pool.Release(type, overLimit.Get(), 1, 101);
+		pool.Release(type, atLimit.Get(), 2, 100);
+		CHECK(pool.GetHighWaterMark() == 101);
+
+		// the one over the limit is skipped and the next retired one handed out instead
+		CHECK(pool.Acquire(type, 2) == atLimit);
+		CHECK(pool.GetDiscardedCount() == 1);
+		CHECK(AsStandIn(overLimit)->GetResetCount() == 0);
+
+		// an allocator at the limit keeps being reused until a recording takes it over
+		pool.Release(type, atLimit.Get(), 3, 10);
+		CHECK(pool.Acquire(type, 3) == atLimit);
+		pool.Release(type, atLimit.Get(), 4, 1);
+		CHECK(pool.Acquire(type, 4) == atLimit);
+		pool.Release(type, atLimit.Get(), 5, 101);
+		CHECK(pool.Acquire(type, 5) != atLimit);
+		CHECK(pool.GetDiscardedCount() == 2);
+		CHECK(pool.GetCreatedCount() == 3);
+	}
+
+	void TestReleaseUnknownAllocator()
+	{
+		StandInCommandAllocatorPool pool;
+		ComPtr<ID3D12CommandAllocator> allocator(new StandInCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT));
+		CHECK_THROWS_HR(pool.Release(D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), 1, 0), E_INVALIDARG);
+
+		// nor can an allocator be given back twice
+		ComPtr<ID3D12CommandAllocator> acquired = pool.Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, 0);
+		pool.Release(D3D12_COMMAND_LIST_TYPE_DIRECT, acquired.Get(), 1, 0);
+		CHECK_THROWS_HR(pool.Release(D3D12_COMMAND_LIST_TYPE_DIRECT, acquired.Get(), 2, 0), E_INVALIDARG);
+	}
+}
+
+int main()
+{
+	TestFenceGatedReuse();
+	TestReleaseOrderPerType();
+	TestDiscardAboveMaxRetained();
+	TestReleaseUnknownAllocator();
+	return GetFailureCount();
+}
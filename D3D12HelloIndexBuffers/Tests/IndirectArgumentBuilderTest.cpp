@@ -0,0 +1,109 @@
+#include "stdafx.h"
+#include "IndirectArgumentBuilder.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	D3D12_DRAW_INDEXED_ARGUMENTS MakeDraw(UINT seed)
+	{
+		D3D12_DRAW_INDEXED_ARGUMENTS draw;
+		draw.IndexCountPerInstance = seed + 1;
+		draw.InstanceCount = seed + 2;
+		draw.StartIndexLocation = seed + 3;
+		draw.BaseVertexLocation = -static_cast<INT>(seed) - 4;
+		draw.StartInstanceLocation = seed + 5;
+		return draw;
+	}
+
+	bool DrawsEqual(const D3D12_DRAW_INDEXED_ARGUMENTS& a, const D3D12_DRAW_INDEXED_ARGUMENTS& b)
+	{
+		return memcmp(&a, &b, sizeof(a)) == 0;
+	}
+
+	// the stride is 4 bytes per root constant plus the 20 byte draw, with no padding
+	void TestByteStride()
+	{
+		CHECK(sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) == 20);
+		for (UINT rootConstantCount = 0; rootConstantCount < 8; rootConstantCount++)
+		{
+			IndirectArgumentBuilder builder(rootConstantCount);
+			CHECK(builder.GetByteStride() == 4 * rootConstantCount + 20);
+			CHECK(builder.GetCommandSignatureDesc().ByteStride == builder.GetByteStride());
+		}
+	}
+
+	// the signature sets the constants first, the draw has to be the last argument
+	void TestCommandSignatureDesc()
+	{
+		IndirectArgumentBuilder drawsOnly;
+		const D3D12_COMMAND_SIGNATURE_DESC& drawsOnlyDesc = drawsOnly.GetCommandSignatureDesc();
+		CHECK(drawsOnlyDesc.NumArgumentDescs == 1);
+		CHECK(drawsOnlyDesc.pArgumentDescs[0].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED);
+
+		IndirectArgumentBuilder withConstants(3, 2);
+		const D3D12_COMMAND_SIGNATURE_DESC& desc = withConstants.GetCommandSignatureDesc();
+		CHECK(desc.NumArgumentDescs == 2);
+		CHECK(desc.pArgumentDescs[0].Type == D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT);
+		CHECK(desc.pArgumentDescs[0].Constant.RootParameterIndex == 2);
+		CHECK(desc.pArgumentDescs[0].Constant.DestOffsetIn32BitValues == 0);
+		CHECK(desc.pArgumentDescs[0].Constant.Num32BitValuesToSet == 3);
+		CHECK(desc.pArgumentDescs[1].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED);
+	}
+
+	// every command is its root constants followed by the draw, commands packed back to back
+	void TestPackedLayout()
+	{
+		const UINT rootConstantCount = 2;
+		IndirectArgumentBuilder builder(rootConstantCount);
+
+		const UINT constants[2][rootConstantCount] = { { 10, 11 }, { 20, 21 } };
+		builder.AddDraw(MakeDraw(0), constants[0]);
+		builder.AddDraw(MakeDraw(100), constants[1]);
+		CHECK(builder.GetCommandCount() == 2);
+		CHECK(builder.GetDataSize() == 2 * builder.GetByteStride());
+
+		const UINT8* pData = static_cast<const UINT8*>(builder.GetData());
+		for (UINT i = 0; i < 2; i++)
+		{
+			const UINT8* pCommand = pData + i * builder.GetByteStride();
+			CHECK(memcmp(pCommand, constants[i], sizeof(constants[i])) == 0);
+
+			D3D12_DRAW_INDEXED_ARGUMENTS draw;
+			memcpy(&draw, pCommand + sizeof(constants[i]), sizeof(draw));
+			CHECK(DrawsEqual(draw, MakeDraw(i * 100)));
+		}
+
+		builder.Clear();
+		CHECK(builder.GetCommandCount() == 0);
+		CHECK(builder.GetDataSize() == 0);
+	}
+
+	void TestDrawsOnly()
+	{
+		IndirectArgumentBuilder builder;
+		builder.AddDraw(MakeDraw(7));
+		CHECK(builder.GetDataSize() == 20);
+
+		D3D12_DRAW_INDEXED_ARGUMENTS draw;
+		memcpy(&draw, builder.GetData(), sizeof(draw));
+		CHECK(DrawsEqual(draw, MakeDraw(7)));
+	}
+
+	// a builder with root constants needs them for every draw
+	void TestMissingRootConstantsThrow()
+	{
+		IndirectArgumentBuilder builder(1);
+		CHECK_THROWS_HR(builder.AddDraw(MakeDraw(0)), E_INVALIDARG);
+		CHECK(builder.GetCommandCount() == 0);
+	}
+}
+
+int main()
+{
+	TestByteStride();
+	TestCommandSignatureDesc();
+	TestPackedLayout();
+	TestDrawsOnly();
+	TestMissingRootConstantsThrow();
+	return GetFailureCount();
+}
@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "PipelineStateCache.h"
+#include "TestHelpers.h"
+
+#include <climits>
+#include <map>
+#include <string>
+
+namespace
+{
+	class StandInPipelineState : public DeviceChildStandIn<ID3D12PipelineState>
+	{
+	public:
+		HRESULT STDMETHODCALLTYPE GetCachedBlob(ID3DBlob** ppBlob) override
+		{
+			*ppBlob = nullptr;
+			return E_NOTIMPL;
+		}
+	};
+
+	class StandInRootSignature : public DeviceChildStandIn<ID3D12RootSignature>
+	{
+	};
+
+	// Keeps the stored psos by name. Like the real library it fails with E_INVALIDARG for
+	// names it doesn't have and for names stored already.
+	class StandInPipelineLibrary : public DeviceChildStandIn<ID3D12PipelineLibrary>
+	{
+	public:
+		HRESULT STDMETHODCALLTYPE StorePipeline(LPCWSTR pName, ID3D12PipelineState* pPipeline) override
+		{
+			if (!m_pipelines.insert(std::make_pair(std::wstring(pName), ComPtr<ID3D12PipelineState>(pPipeline))).second)
+			{
+				return E_INVALIDARG;
+			}
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE LoadGraphicsPipeline(LPCWSTR pName, const D3D12_GRAPHICS_PIPELINE_STATE_DESC*, REFIID riid, void** ppPipelineState) override
+		{
+			auto pipeline = m_pipelines.find(pName);
+			if (pipeline == m_pipelines.end())
+			{
+				*ppPipelineState = nullptr;
+				return E_INVALIDARG;
+			}
+			return pipeline->second->QueryInterface(riid, ppPipelineState);
+		}
+
+		HRESULT STDMETHODCALLTYPE LoadComputePipeline(LPCWSTR, const D3D12_COMPUTE_PIPELINE_STATE_DESC*, REFIID, void** ppPipelineState) override
+		{
+			*ppPipelineState = nullptr;
+			return E_NOTIMPL;
+		}
+
+		SIZE_T STDMETHODCALLTYPE GetSerializedSize() override { return 0; }
+		HRESULT STDMETHODCALLTYPE Serialize(void*, SIZE_T) override { return E_NOTIMPL; }
+
+		UINT GetPipelineCount() const { return static_cast<UINT>(m_pipelines.size()); }
+
+	private:
+		std::map<std::wstring, ComPtr<ID3D12PipelineState>> m_pipelines;
+	};
+
+	// compiles stand-ins instead of going to a device
+	class StandInPipelineStateCache : public PipelineStateCache
+	{
+	public:
+		explicit StandInPipelineStateCache(ID3D12PipelineLibrary* pLibrary) :
+			PipelineStateCache(nullptr, pLibrary),
+			m_compileCount(0)
+		{
+		}
+
+		UINT GetCompileCount() const { return m_compileCount; }
+
+	protected:
+		ComPtr<ID3D12PipelineState> CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC&) override
+		{
+			m_compileCount++;
+			return ComPtr<ID3D12PipelineState>(new StandInPipelineState());
+		}
+
+	private:
+		UINT m_compileCount;
+	};
+
+	const UINT8 VertexShader[] = { 'v', 's', 0, 1 };
+	const UINT8 PixelShader[] = { 'p', 's', 0, 1 };
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC MakeDesc()
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+		desc.VS = { VertexShader, sizeof(VertexShader) };
+		desc.PS = { PixelShader, sizeof(PixelShader) };
+		desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+		desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+		desc.SampleMask = UINT_MAX;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.SampleDesc.Count = 1;
+		return desc;
+	}
+
+	// the first lookup compiles and stores the pso, the second loads it from the library
+	void TestMissThenHit()
+	{
+		ComPtr<StandInPipelineLibrary> library(new StandInPipelineLibrary());
+		StandInPipelineStateCache cache(library.Get());
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc();
+
+		ComPtr<ID3D12PipelineState> compiled = cache.GetGraphicsPipelineState(desc);
+		CHECK(compiled != nullptr);
+		CHECK(cache.GetMissCount() == 1);
+		CHECK(cache.GetHitCount() == 0);
+		CHECK(cache.GetCompileCount() == 1);
+		CHECK(library->GetPipelineCount() == 1);
+
+		ComPtr<ID3D12PipelineState> loaded = cache.GetGraphicsPipelineState(desc);
+		CHECK(loaded == compiled);
+		CHECK(cache.GetMissCount() == 1);
+		CHECK(cache.GetHitCount() == 1);
+		CHECK(cache.GetCompileCount() == 1);
+	}
+
+	// any change to the description changes its hash, so the stored pso no longer matches
+	void TestDescChangeMisses()
+	{
+		ComPtr<StandInPipelineLibrary> library(new StandInPipelineLibrary());
+		StandInPipelineStateCache cache(library.Get());
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc();
+		ComPtr<ID3D12PipelineState> original = cache.GetGraphicsPipelineState(desc);
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC changedState = desc;
+		changedState.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+		CHECK(cache.HashGraphicsPipelineDesc(changedState) != cache.HashGraphicsPipelineDesc(desc));
+		CHECK(cache.GetGraphicsPipelineState(changedState) != original);
+
+		// so does different shader bytecode
+		const UINT8 otherVertexShader[] = { 'v', 's', 0, 2 };
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC changedShader = desc;
+		changedShader.VS = { otherVertexShader, sizeof(otherVertexShader) };
+		CHECK(cache.GetGraphicsPipelineState(changedShader) != original);
+
+		CHECK(cache.GetMissCount() == 3);
+		CHECK(cache.GetCompileCount() == 3);
+		CHECK(library->GetPipelineCount() == 3);
+
+		// the original pso is still stored under its own hash
+		CHECK(cache.GetGraphicsPipelineState(desc) == original);
+		CHECK(cache.GetHitCount() == 1);
+	}
+
+	// root signatures are hashed by their serialized contents, so a root signature recreated
+	// from the same blob finds the psos stored with the old one
+	void TestRootSignatureContents()
+	{
+		ComPtr<StandInPipelineLibrary> library(new StandInPipelineLibrary());
+		StandInPipelineStateCache cache(library.Get());
+		ComPtr<ID3D12RootSignature> rootSignature(new StandInRootSignature());
+		ComPtr<ID3D12RootSignature> recreatedRootSignature(new StandInRootSignature());
+		ComPtr<ID3D12RootSignature> otherRootSignature(new StandInRootSignature());
+		const UINT8 serialized[] = { 1, 2, 3, 4 };
+		const UINT8 otherSerialized[] = { 1, 2, 3, 5 };
+		cache.RegisterRootSignature(rootSignature.Get(), serialized, sizeof(serialized));
+		cache.RegisterRootSignature(recreatedRootSignature.Get(), serialized, sizeof(serialized));
+		cache.RegisterRootSignature(otherRootSignature.Get(), otherSerialized, sizeof(otherSerialized));
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc();
+		desc.pRootSignature = rootSignature.Get();
+		ComPtr<ID3D12PipelineState> original = cache.GetGraphicsPipelineState(desc);
+
+		desc.pRootSignature = recreatedRootSignature.Get();
+		CHECK(cache.GetGraphicsPipelineState(desc) == original);
+		CHECK(cache.GetHitCount() == 1);
+
+		desc.pRootSignature = otherRootSignature.Get();
+		CHECK(cache.GetGraphicsPipelineState(desc) != original);
+		CHECK(cache.GetMissCount() == 2);
+
+		// a root signature the cache doesn't know can't be hashed
+		ComPtr<ID3D12RootSignature> unregisteredRootSignature(new StandInRootSignature());
+		desc.pRootSignature = unregisteredRootSignature.Get();
+		CHECK_THROWS_HR(cache.GetGraphicsPipelineState(desc), E_INVALIDARG);
+	}
+
+	// without a library every lookup compiles
+	void TestWithoutLibrary()
+	{
+		StandInPipelineStateCache cache(nullptr);
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc();
+		cache.GetGraphicsPipelineState(desc);
+		cache.GetGraphicsPipelineState(desc);
+		CHECK(cache.GetMissCount() == 2);
+		CHECK(cache.GetHitCount() == 0);
+		CHECK(cache.GetCompileCount() == 2);
+	}
+}
+
+int main()
+{
+	TestMissThenHit();
+	TestDescChangeMisses();
+	TestRootSignatureContents();
+	TestWithoutLibrary();
+	return GetFailureCount();
+}
@@ -0,0 +1,114 @@
+#include "stdafx.h"
+#include "CopyQueue.h"
+#include "TestHelpers.h"
+
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct StandInFence
+	{
+		UINT64 completedValue = 0;
+
+		UINT64 GetCompletedValue() const { return completedValue; }
+	};
+
+	// records the waits queued on it instead of making the gpu wait
+	struct StandInQueue
+	{
+		std::vector<std::pair<StandInFence*, UINT64>> waits;
+		HRESULT waitResult = S_OK;
+
+		HRESULT Wait(StandInFence* pFence, UINT64 value)
+		{
+			if (SUCCEEDED(waitResult))
+			{
+				waits.push_back(std::make_pair(pFence, value));
+			}
+			return waitResult;
+		}
+	};
+
+	typedef QueueWaitTracker<StandInQueue, StandInFence> StandInWaitTracker;
+
+	// a queue only waits again for values newer than the last one it waited for
+	void TestWaitsOnlyForNewerValues()
+	{
+		StandInFence fence;
+		StandInQueue queue;
+		StandInWaitTracker tracker(&fence);
+
+		CHECK(tracker.Wait(&queue, 2));
+		CHECK(!tracker.Wait(&queue, 2));
+		CHECK(!tracker.Wait(&queue, 1));
+		CHECK(tracker.Wait(&queue, 3));
+		CHECK(tracker.GetWaitedValue(&queue) == 3);
+
+		CHECK(queue.waits.size() == 2);
+		CHECK(queue.waits[0].first == &fence && queue.waits[0].second == 2);
+		CHECK(queue.waits[1].first == &fence && queue.waits[1].second == 3);
+	}
+
+	// nothing is queued for values the fence has passed, and they don't count as waited for
+	void TestSkipsCompletedValues()
+	{
+		StandInFence fence;
+		StandInQueue queue;
+		StandInWaitTracker tracker(&fence);
+
+		fence.completedValue = 4;
+		CHECK(!tracker.Wait(&queue, 3));
+		CHECK(!tracker.Wait(&queue, 4));
+		CHECK(queue.waits.empty());
+		CHECK(tracker.GetWaitedValue(&queue) == 0);
+
+		CHECK(tracker.Wait(&queue, 5));
+		CHECK(queue.waits.size() == 1);
+	}
+
+	// every queue is tracked on its own
+	void TestTracksQueuesSeparately()
+	{
+		StandInFence fence;
+		StandInQueue direct;
+		StandInQueue compute;
+		StandInWaitTracker tracker(&fence);
+
+		CHECK(tracker.Wait(&direct, 2));
+		CHECK(tracker.GetWaitedValue(&compute) == 0);
+		CHECK(tracker.Wait(&compute, 2));
+		CHECK(!tracker.Wait(&direct, 1));
+		CHECK(tracker.Wait(&compute, 3));
+
+		CHECK(direct.waits.size() == 1);
+		CHECK(compute.waits.size() == 2);
+		CHECK(tracker.GetWaitedValue(&direct) == 2);
+		CHECK(tracker.GetWaitedValue(&compute) == 3);
+	}
+
+	// a wait the queue rejected isn't remembered, so the next call tries again
+	void TestFailedWaitIsRetried()
+	{
+		StandInFence fence;
+		StandInQueue queue;
+		StandInWaitTracker tracker(&fence);
+
+		queue.waitResult = E_OUTOFMEMORY;
+		CHECK_THROWS_HR(tracker.Wait(&queue, 2), E_OUTOFMEMORY);
+		CHECK(tracker.GetWaitedValue(&queue) == 0);
+
+		queue.waitResult = S_OK;
+		CHECK(tracker.Wait(&queue, 2));
+		CHECK(queue.waits.size() == 1);
+	}
+}
+
+int main()
+{
+	TestWaitsOnlyForNewerValues();
+	TestSkipsCompletedValues();
+	TestTracksQueuesSeparately();
+	TestFailedWaitIsRetried();
+	return GetFailureCount();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks for the device-free tests. A failed check is printed and counted, the test keeps
+// going, and main() returns the count so ctest sees the failure.
+inline int& GetFailureCount()
+{
+	static int failureCount = 0;
+	return failureCount;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			GetFailureCount()++; \
+		} \
+	} while (false)
+
+// the statement has to throw an HrException carrying expectedHr
+#define CHECK_THROWS_HR(statement, expectedHr) \
+	do \
+	{ \
+		HRESULT thrownHr = S_OK; \
+		try \
+		{ \
+			statement; \
+		} \
+		catch (const HrException& e) \
+		{ \
+			thrownHr = e.Error(); \
+		} \
+		if (thrownHr != (expectedHr)) \
+		{ \
+			printf("%s(%d): %s threw 0x%08X, expected %s\n", __FILE__, __LINE__, #statement, static_cast<UINT>(thrownHr), #expectedHr); \
+			GetFailureCount()++; \
+		} \
+	} while (false)
+
+// Implements IUnknown, ID3D12Object and ID3D12DeviceChild for a stand-in of a D3D12
+// interface, so the stand-in only implements the methods the code under test calls.
+// Reference counted like the real objects; hand it to a ComPtr right after new.
+template<typename Interface>
+class DeviceChildStandIn : public Interface
+{
+public:
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (riid != __uuidof(IUnknown) && riid != __uuidof(Interface))
+		{
+			*ppvObject = nullptr;
+			return E_NOINTERFACE;
+		}
+		AddRef();
+		*ppvObject = static_cast<Interface*>(this);
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override { return ++m_refCount; }
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		const ULONG refCount = --m_refCount;
+		if (refCount == 0)
+		{
+			delete this;
+		}
+		return refCount;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** ppvDevice) override
+	{
+		*ppvDevice = nullptr;
+		return E_NOTIMPL;
+	}
+
+protected:
+	DeviceChildStandIn() : m_refCount(0) {}
+	virtual ~DeviceChildStandIn() {}
+
+private:
+	ULONG m_refCount;
+};
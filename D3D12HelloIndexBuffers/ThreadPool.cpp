@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(UINT threadCount) :
+	m_stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (UINT i = 0; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&ThreadPool::WorkerThread, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	// finish the queued tasks, then let the workers exit
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::WorkerThread()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+			if (m_tasks.empty())
+			{
+				return; // stopping and nothing left to do
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+
+		// exceptions end up in the task's future
+		task();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running tasks in the order they were submitted.
+// Submit() returns a future for the task's result. Because tasks are started in
+// submission order, a task may block on the future of a task submitted before it
+// without risking a deadlock.
+class ThreadPool
+{
+public:
+	// threadCount of 0 uses one thread per hardware thread
+	explicit ThreadPool(UINT threadCount = 0);
+	~ThreadPool();
+
+	template<typename Task>
+	auto Submit(Task task) -> std::future<decltype(task())>
+	{
+		// std::function needs a copyable target, so the packaged task is shared
+		typedef decltype(task()) Result;
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packagedTask->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push([packagedTask]() { (*packagedTask)(); });
+		}
+		m_taskAvailable.notify_one();
+		return result;
+	}
+
+	UINT GetThreadCount() const { return static_cast<UINT>(m_threads.size()); }
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void WorkerThread();
+
+	std::vector<std::thread> m_threads;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	bool m_stopping;
+};
@@ -0,0 +1,54 @@
+#include "stdafx.h"
+#include "UploadRingBuffer.h"
+
+UploadRingBuffer::UploadRingBuffer(ID3D12Device* pDevice, ID3D12Fence* pFence, UINT64 size) :
+	m_pCpuBase(nullptr),
+	m_gpuBase(0),
+	m_ring(pFence, size)
+{
+	ThrowIfFailed(pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ, // upload heaps have to stay in this state
+		nullptr,
+		IID_PPV_ARGS(&m_buffer)));
+
+	// Keep the buffer mapped for its whole lifetime, upload heaps are write combined
+	// so the cpu should only ever write to this memory sequentially.
+	CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
+	ThrowIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pCpuBase)));
+	m_gpuBase = m_buffer->GetGPUVirtualAddress();
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	// the owner is responsible for making sure the gpu is done with the buffer
+	m_buffer->Unmap(0, nullptr);
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::Allocate(UINT64 size, UINT64 alignment)
+{
+	return GetAllocation(m_ring.Allocate(size, alignment));
+}
+
+bool UploadRingBuffer::TryAllocate(UINT64 size, UINT64 alignment, Allocation* pAllocation)
+{
+	UINT64 offset;
+	if (!m_ring.TryAllocate(size, alignment, &offset))
+	{
+		return false;
+	}
+	*pAllocation = GetAllocation(offset);
+	return true;
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::GetAllocation(UINT64 offset) const
+{
+	Allocation allocation;
+	allocation.pResource = m_buffer.Get();
+	allocation.offset = offset;
+	allocation.pCpuAddress = m_pCpuBase + offset;
+	allocation.gpuAddress = m_gpuBase + offset;
+	return allocation;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "DXSampleHelper.h"
+#include "RingAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// One large, persistently mapped upload buffer that is carved up as a ring.
+// Allocations are handed out from the head and given back once the fence passes the
+// submission that used them, see RingAllocator. Every upload in the app can share the
+// same staging memory instead of creating an upload resource per buffer.
+class UploadRingBuffer
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* pResource; // the upload buffer the allocation lives in
+		UINT64 offset; // offset of the allocation inside pResource
+		void* pCpuAddress; // where the cpu writes the data
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress; // where the gpu reads the data
+	};
+
+	UploadRingBuffer(ID3D12Device* pDevice, ID3D12Fence* pFence, UINT64 size);
+	~UploadRingBuffer();
+
+	// Allocates space in the ring, waiting for the gpu to retire older submissions if the ring is full.
+	Allocation Allocate(UINT64 size, UINT64 alignment);
+
+	// Same as Allocate() but never waits, returns false when the space isn't free yet.
+	bool TryAllocate(UINT64 size, UINT64 alignment, Allocation* pAllocation);
+
+	// Marks every allocation made since the last call as in use until the fence reaches fenceValue.
+	void Submit(UINT64 fenceValue) { m_ring.Submit(fenceValue); }
+
+	// Gives back the space of every submission the gpu has finished with.
+	void Reclaim(UINT64 completedFenceValue) { m_ring.Reclaim(completedFenceValue); }
+
+	UINT64 GetSize() const { return m_ring.GetSize(); }
+	UINT64 GetUsedSize() const { return m_ring.GetUsedSize(); }
+
+private:
+	Allocation GetAllocation(UINT64 offset) const;
+
+	ComPtr<ID3D12Resource> m_buffer;
+	UINT8* m_pCpuBase;
+	D3D12_GPU_VIRTUAL_ADDRESS m_gpuBase;
+	RingAllocator m_ring; // in bytes
+};
@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "VertexPacker.h"
+
+#include <cfloat>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace
+{
+	const D3D12_INPUT_ELEMENT_DESC PackedInputElementDescs[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, offsetof(PackedVertex, position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(PackedVertex, color), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	// loads xyz of a float3, w is 0. the 4th float is read through a scalar load so nothing past the position is touched.
+	inline __m128 LoadFloat3(const float* pValue)
+	{
+		const __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(pValue)));
+		const __m128 z = _mm_load_ss(pValue + 2);
+		return _mm_movelh_ps(xy, z);
+	}
+
+	// snorm decode as the input assembler does it: c / 32767, with -32768 clamped to -1
+	inline float DecodeSnorm16(INT16 value)
+	{
+		return max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+}
+
+VertexPacker::VertexPacker(const void* pVertices, UINT vertexCount, UINT strideInBytes, UINT positionOffset, UINT colorOffset) :
+	m_pVertices(static_cast<const UINT8*>(pVertices)),
+	m_vertexCount(vertexCount),
+	m_strideInBytes(strideInBytes),
+	m_positionOffset(positionOffset),
+	m_colorOffset(colorOffset)
+{
+	// bounds of the mesh
+	__m128 minimum = _mm_set1_ps(FLT_MAX);
+	__m128 maximum = _mm_set1_ps(-FLT_MAX);
+	for (UINT i = 0; i < vertexCount; i++)
+	{
+		const __m128 position = LoadFloat3(reinterpret_cast<const float*>(GetVertex(i) + positionOffset));
+		minimum = _mm_min_ps(minimum, position);
+		maximum = _mm_max_ps(maximum, position);
+	}
+	if (vertexCount == 0)
+	{
+		minimum = maximum = _mm_setzero_ps();
+	}
+
+	// the center of the bounds maps to 0 and the extents to -1 and 1
+	const __m128 half = _mm_set1_ps(0.5f);
+	_mm_storeu_ps(m_positionScale, _mm_mul_ps(_mm_sub_ps(maximum, minimum), half));
+	_mm_storeu_ps(m_positionBias, _mm_mul_ps(_mm_add_ps(maximum, minimum), half));
+	m_positionScale[3] = 0.0f;
+	m_positionBias[3] = 1.0f;
+
+	// Rounding to the nearest snorm16 value is off by at most half a step. Computing the
+	// normalized value and the decode in the shader each add a few float ulps of the magnitude.
+	float largestScale = 0.0f;
+	float largestMagnitude = 0.0f;
+	for (UINT axis = 0; axis < 3; axis++)
+	{
+		largestScale = max(largestScale, m_positionScale[axis]);
+		largestMagnitude = max(largestMagnitude, fabsf(m_positionBias[axis]) + m_positionScale[axis]);
+	}
+	m_positionErrorBound = 0.5f * largestScale / 32767.0f + 4.0f * FLT_EPSILON * largestMagnitude;
+}
+
+void VertexPacker::Pack(PackedVertex* pPackedVertices) const
+{
+	// a flat axis has a scale of 0, its snorm value is always 0 and only the bias is left
+	float inverseScale[4];
+	for (UINT axis = 0; axis < 4; axis++)
+	{
+		inverseScale[axis] = m_positionScale[axis] > 0.0f ? 1.0f / m_positionScale[axis] : 0.0f;
+	}
+
+	const __m128 positionInverseScale = _mm_loadu_ps(inverseScale);
+	const __m128 positionBias = _mm_loadu_ps(m_positionBias);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 snormMax = _mm_set1_ps(32767.0f);
+	const __m128 unormMax = _mm_set1_ps(255.0f);
+
+	for (UINT i = 0; i < m_vertexCount; i++)
+	{
+		const UINT8* pVertex = GetVertex(i);
+
+		// position: (p - bias) / scale in [-1, 1], then to the nearest of the 32767 steps
+		__m128 position = LoadFloat3(reinterpret_cast<const float*>(pVertex + m_positionOffset));
+		position = _mm_mul_ps(_mm_sub_ps(position, positionBias), positionInverseScale);
+		position = _mm_min_ps(_mm_max_ps(position, minusOne), one);
+		const __m128i positionInt = _mm_cvtps_epi32(_mm_mul_ps(position, snormMax)); // rounds to nearest
+		const __m128i position16 = _mm_packs_epi32(positionInt, positionInt);
+
+		// color: clamp to [0, 1], then to the nearest of the 255 steps
+		__m128 color = _mm_loadu_ps(reinterpret_cast<const float*>(pVertex + m_colorOffset));
+		color = _mm_min_ps(_mm_max_ps(color, zero), one);
+		const __m128i colorInt = _mm_cvtps_epi32(_mm_mul_ps(color, unormMax));
+		const __m128i color16 = _mm_packs_epi32(colorInt, colorInt);
+		const __m128i color8 = _mm_packus_epi16(color16, color16);
+
+		// the 8 bytes of position and 4 bytes of color make up the whole vertex
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pPackedVertices[i].position), position16);
+		*reinterpret_cast<int*>(pPackedVertices[i].color) = _mm_cvtsi128_si32(color8);
+	}
+}
+
+float VertexPacker::CheckError(const PackedVertex* pPackedVertices) const
+{
+	float maxPositionError = 0.0f;
+	float maxColorError = 0.0f;
+
+	for (UINT i = 0; i < m_vertexCount; i++)
+	{
+		const UINT8* pVertex = GetVertex(i);
+		const float* pPosition = reinterpret_cast<const float*>(pVertex + m_positionOffset);
+		const float* pColor = reinterpret_cast<const float*>(pVertex + m_colorOffset);
+
+		for (UINT axis = 0; axis < 3; axis++)
+		{
+			// what the vertex shader computes
+			const float decoded = DecodeSnorm16(pPackedVertices[i].position[axis]) * m_positionScale[axis] + m_positionBias[axis];
+			maxPositionError = max(maxPositionError, fabsf(decoded - pPosition[axis]));
+		}
+
+		for (UINT channel = 0; channel < 4; channel++)
+		{
+			const float expected = min(max(pColor[channel], 0.0f), 1.0f);
+			maxColorError = max(maxColorError, fabsf(pPackedVertices[i].color[channel] / 255.0f - expected));
+		}
+	}
+
+	if (maxPositionError > m_positionErrorBound || maxColorError > 0.5f / 255.0f + FLT_EPSILON)
+	{
+		throw HrException(E_FAIL);
+	}
+
+	return maxPositionError;
+}
+
+D3D12_INPUT_LAYOUT_DESC VertexPacker::GetInputLayout()
+{
+	return { PackedInputElementDescs, _countof(PackedInputElementDescs) };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "DXSampleHelper.h"
+
+// Vertex layout the gpu reads, 12 bytes instead of the 28 of a float3 position and
+// a float4 color. Positions are snorm16 relative to the bounds of their mesh, colors
+// are unorm8.
+struct PackedVertex
+{
+	INT16 position[4]; // R16G16B16A16_SNORM, w is unused
+	UINT8 color[4]; // R8G8B8A8_UNORM
+};
+
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex has to match the input layout");
+
+// Quantizes float vertices into PackedVertex with SSE2. The scale and bias that map the
+// snorm positions back to the mesh's real range are computed from its bounds, and have to
+// be applied by the vertex shader: position = packed * scale + bias.
+class VertexPacker
+{
+public:
+	// Reads a float3 position and a float4 color from each vertex at the given offsets.
+	VertexPacker(const void* pVertices, UINT vertexCount, UINT strideInBytes, UINT positionOffset, UINT colorOffset);
+
+	// Writes GetVertexCount() packed vertices.
+	void Pack(PackedVertex* pPackedVertices) const;
+
+	// Decodes the packed vertices the way the gpu does and returns the largest error of any
+	// position component. Throws if it is above GetPositionErrorBound() or a color is off by
+	// more than half a unorm8 step, which means the packing is broken.
+	float CheckError(const PackedVertex* pPackedVertices) const;
+
+	// half a snorm16 step of the largest axis, plus the float rounding of the decode
+	float GetPositionErrorBound() const { return m_positionErrorBound; }
+
+	const float* GetPositionScale() const { return m_positionScale; } // xyz, w is 0
+	const float* GetPositionBias() const { return m_positionBias; } // xyz, w is 1
+	UINT GetVertexCount() const { return m_vertexCount; }
+
+	// input layout matching PackedVertex, for the pso
+	static D3D12_INPUT_LAYOUT_DESC GetInputLayout();
+
+private:
+	const UINT8* GetVertex(UINT index) const { return m_pVertices + static_cast<size_t>(index) * m_strideInBytes; }
+
+	const UINT8* m_pVertices;
+	UINT m_vertexCount;
+	UINT m_strideInBytes;
+	UINT m_positionOffset;
+	UINT m_colorOffset;
+
+	float m_positionScale[4];
+	float m_positionBias[4];
+	float m_positionErrorBound;
+};
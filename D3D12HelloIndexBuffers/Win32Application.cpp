@@ -16,6 +16,17 @@ HWND Win32Application::m_hwnd = nullptr;
 
 int Win32Application::Run(HelloIndexBuffers* pSample, HINSTANCE hInstance, int nCmdShow)
 {
+	// Parse the command line parameters
+	int argc;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	pSample->ParseCommandLineArgs(argv, argc);
+	LocalFree(argv);
+
+	if (pSample->IsHeadless())
+	{
+		return RunHeadless(pSample);
+	}
+
 	// Initialize the window class
 	WNDCLASSEX windowClass = { 0 };
 	windowClass.cbSize = sizeof(WNDCLASSEX);
@@ -48,16 +59,43 @@ int Win32Application::Run(HelloIndexBuffers* pSample, HINSTANCE hInstance, int n
 
 	ShowWindow(m_hwnd, nCmdShow);
 
-	// Main sample loop
+	// Main sample loop. Frames are rendered back to back whenever the message queue is
+	// empty, vsync in Present() paces them.
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
 	{
-		// Process any messages in the queue.
+		// Process any messages in the queue before the next frame.
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			continue;
+		}
+
+		// Frames nobody can see aren't worth rendering, so sleep until a message arrives instead.
+		// Restoring a minimized window always sends messages, but a window that is uncovered
+		// isn't told, so occlusion is checked again every OcclusionPollInterval.
+		if (IsIconic(m_hwnd))
+		{
+			MsgWaitForMultipleObjectsEx(0, nullptr, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			continue;
+		}
+		if (pSample->IsOccluded())
+		{
+			MsgWaitForMultipleObjectsEx(0, nullptr, OcclusionPollInterval, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			continue;
+		}
+
+		// Wait for the swap chain to have room for another frame, still handling messages. The
+		// timeout only keeps the loop going should the object never be signaled.
+		HANDLE frameLatencyWaitable = pSample->GetFrameLatencyWaitableObject();
+		if (frameLatencyWaitable && MsgWaitForMultipleObjectsEx(1, &frameLatencyWaitable, FrameLatencyTimeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_OBJECT_0 + 1)
+		{
+			continue;
 		}
+
+		pSample->OnUpdate();
+		pSample->OnRender();
 	}
 
 	pSample->OnDestroy();
@@ -66,6 +104,70 @@ int Win32Application::Run(HelloIndexBuffers* pSample, HINSTANCE hInstance, int n
 	return static_cast<char>(msg.wParam);
 }
 
+// Render a fixed number of frames without a window and report the frame times
+int Win32Application::RunHeadless(HelloIndexBuffers* pSample)
+{
+	pSample->OnInit();
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	const UINT frameCount = pSample->GetHeadlessFrameCount();
+	LONGLONG totalTicks = 0;
+	LONGLONG minTicks = MAXLONGLONG;
+	LONGLONG maxTicks = 0;
+
+	for (UINT frame = 0; frame < frameCount; frame++)
+	{
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+
+		pSample->OnUpdate();
+		pSample->OnRender();
+
+		QueryPerformanceCounter(&end);
+
+		const LONGLONG ticks = end.QuadPart - start.QuadPart;
+		totalTicks += ticks;
+		minTicks = min(minTicks, ticks);
+		maxTicks = max(maxTicks, ticks);
+	}
+
+	pSample->OnDestroy();
+
+	if (frameCount > 0)
+	{
+		// The exe is a windows subsystem app, so stdout only goes somewhere when it was redirected.
+		// Otherwise write to the console it was started from, if any. The debugger gets the report too.
+		if (GetStdHandle(STD_OUTPUT_HANDLE) == nullptr && AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			FILE* pFile = nullptr;
+			freopen_s(&pFile, "CONOUT$", "w", stdout);
+		}
+
+		WCHAR message[256];
+		const double msPerTick = 1000.0 / static_cast<double>(frequency.QuadPart);
+		swprintf_s(message, L"%ls: %u frames, avg %.3f ms, min %.3f ms, max %.3f ms\n",
+			pSample->GetTitle(),
+			frameCount,
+			totalTicks * msPerTick / frameCount,
+			minTicks * msPerTick,
+			maxTicks * msPerTick);
+		OutputDebugStringW(message);
+		printf("%ls", message);
+
+		const MeshOptimizer::CacheStatistics& inputStatistics = pSample->GetInputCacheStatistics();
+		const MeshOptimizer::CacheStatistics& outputStatistics = pSample->GetOutputCacheStatistics();
+		swprintf_s(message, L"%ls: vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			pSample->GetTitle(), inputStatistics.acmr, outputStatistics.acmr, inputStatistics.atvr, outputStatistics.atvr);
+		OutputDebugStringW(message);
+		printf("%ls", message);
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
 // Main message handler for the sample
 LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
@@ -81,14 +183,6 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
 		}
 		return 0;
 
-	case WM_PAINT:
-		if (pSample)
-		{
-			pSample->OnUpdate();
-			pSample->OnRender();
-		}
-		return 0;
-
 	case WM_DESTROY:
 		PostQuitMessage(0);
 		return 0;
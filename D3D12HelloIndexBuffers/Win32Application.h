@@ -22,8 +22,12 @@ public:
 	static HWND GetHwnd() { return m_hwnd; }
 
 protected:
+	static int RunHeadless(HelloIndexBuffers* pSample);
 	static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
 private:
+	static const DWORD OcclusionPollInterval = 100; // milliseconds between checks whether an occluded window is visible again
+	static const DWORD FrameLatencyTimeout = 1000; // milliseconds to wait for the swap chain before rendering anyway
+
 	static HWND m_hwnd; // window handle
 };
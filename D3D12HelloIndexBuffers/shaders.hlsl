@@ -1,15 +1,24 @@
+cbuffer SceneConstantBuffer : register(b0)
+{
+	float4 offset;
+	float4 positionScale; // positions are stored as snorm16 relative to the bounds of the mesh,
+	float4 positionBias;  // these map them back to the real range
+};
+
 struct PSInput
 {
 	float4 position : SV_POSITION;
 	float4 color : COLOR;
 };
 
-PSInput VSMain(float4 position : POSITION, float4 color : COLOR)
+// instanceTransform and instanceColor come from the second input slot and step once per instance
+PSInput VSMain(float4 position : POSITION, float4 color : COLOR, float4 instanceTransform : INSTANCETRANSFORM, float4 instanceColor : INSTANCECOLOR)
 {
 	PSInput result;
 
-	result.position = position;
-	result.color = color;
+	float3 meshPosition = position.xyz * positionScale.xyz + positionBias.xyz;
+	result.position = float4(meshPosition.xy * instanceTransform.xy + instanceTransform.zw, meshPosition.z, 1.0f) + offset; // xy scale, zw offset
+	result.color = color * instanceColor;
 
 	return result;
 }
@@ -9,12 +9,14 @@
 #endif
 
 #include <windows.h>
+#include <shellapi.h>
 
 #include <d3d12.h>
-#include <dxgi1_4.h>
+#include <dxgi1_6.h>
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
 #include "d3dx12.h"
 
+#include <memory>
 #include <string>
 #include <wrl.h>
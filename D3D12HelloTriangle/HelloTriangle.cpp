@@ -5,11 +5,19 @@ HelloTriangle::HelloTriangle(UINT width, UINT height, wstring name) :
 	m_width(width),
 	m_height(height),
 	m_title(name),
+	m_occluded(false),
 	m_frameIndex(0),
+	m_frameContextIndex(0),
 	m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
 	m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
+	m_frameContexts{},
+	m_nextFenceValue(1),
+	m_frameCount(0),
+	m_fenceWaitCount(0),
+	m_fenceWaitTicks(0),
 	m_rtvDescriptorSize(0)
 {
+	QueryPerformanceFrequency(&m_ticksPerSecond);
 }
 
 HelloTriangle::~HelloTriangle()
@@ -38,19 +46,43 @@ void HelloTriangle::OnRender()
 	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
 	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
-	// present the frame
-	ThrowIfFailed(m_swapChain->Present(1, 0));
+	// Present the frame. DXGI_STATUS_OCCLUDED isn't an error, it means nothing of the
+	// window is visible and the message loop can stop rendering until that changes.
+	const HRESULT hr = m_swapChain->Present(1, 0);
+	ThrowIfFailed(hr);
+	m_occluded = hr == DXGI_STATUS_OCCLUDED;
 
-	WaitForPreviousFrame();
+	MoveToNextFrame();
 }
 
 void HelloTriangle::OnDestroy()
 {
 	// Ensure that the GPU is no longer referencing resources that are about to be
 	// cleaned up by the destructor.
-	WaitForPreviousFrame();
+	WaitForGPU();
 
 	CloseHandle(m_fenceEvent);
+
+	// report how often the frame ring was full and the cpu had to wait for the gpu
+	WCHAR message[256];
+	swprintf_s(message, L"%ls: the cpu waited for the gpu in %llu of %llu frames (%.3f ms total)\n",
+		m_title.c_str(), m_fenceWaitCount, m_frameCount, GetFenceWaitTime());
+	OutputDebugStringW(message);
+}
+
+double HelloTriangle::GetFenceWaitTime() const
+{
+	return static_cast<double>(m_fenceWaitTicks) * 1000.0 / static_cast<double>(m_ticksPerSecond.QuadPart);
+}
+
+// Tests whether the window is still occluded, without presenting anything
+bool HelloTriangle::IsOccluded()
+{
+	if (m_occluded)
+	{
+		m_occluded = m_swapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED;
+	}
+	return m_occluded;
 }
 
 // Load the rendering pipeline dependencies
@@ -144,7 +176,11 @@ void HelloTriangle::LoadPipeline()
 
 	// -- Create Command Allocators -- //
 
-	ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
+	// one allocator per frame context, an allocator can only be reset once the gpu is done with the frame recorded into it
+	for (UINT n = 0; n < FramesInFlight; n++)
+	{
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_frameContexts[n].commandAllocator)));
+	}
 }
 
 // Load application resources
@@ -213,7 +249,7 @@ void HelloTriangle::LoadResource()
 	// -- Create Command List -- //
 
 	// create a command list with the first allocator
-	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_frameContexts[m_frameContextIndex].commandAllocator.Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
 
 	// Command lists are created in the recording state, but there is nothing
 	// to record yet. The main loop expects it to be closed, so close it now.
@@ -261,7 +297,6 @@ void HelloTriangle::LoadResource()
 	// Create synchronization objects and wait until assets have been uploaded to the GPU.
 	{
 		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
-		m_fenceValue = 1;
 
 		// Create an event handle to use for frame synchronization.
 		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
@@ -273,7 +308,7 @@ void HelloTriangle::LoadResource()
 		// Wait for the command list to execute; we are reusing the same command 
 		// list in our main loop but for now, we just want to wait for setup to 
 		// complete before continuing.
-		WaitForPreviousFrame();
+		WaitForGPU();
 	}
 }
 
@@ -282,12 +317,14 @@ void HelloTriangle::PopulateCommandList()
 	// Command list allocators can only be reset when the associated 
 	// command lists have finished execution on the GPU; apps should use 
 	// fences to determine GPU execution progress.
-	ThrowIfFailed(m_commandAllocator->Reset());
+	// MoveToNextFrame() already waited for the frame that last used this context.
+	ID3D12CommandAllocator* pCommandAllocator = m_frameContexts[m_frameContextIndex].commandAllocator.Get();
+	ThrowIfFailed(pCommandAllocator->Reset());
 
 	// However, when ExecuteCommandList() is called on a particular command 
 	// list, that command list can then be reset at any time and must be before 
 	// re-recording.
-	ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get()));
+	ThrowIfFailed(m_commandList->Reset(pCommandAllocator, m_pipelineState.Get()));
 
 	// Set necessary state.
 	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
@@ -313,14 +350,15 @@ void HelloTriangle::PopulateCommandList()
 	ThrowIfFailed(m_commandList->Close());
 }
 
-void HelloTriangle::WaitForPreviousFrame()
+// Wait for pending GPU work to complete, only used at startup and shutdown.
+void HelloTriangle::WaitForGPU()
 {
 	// Signal and increment the fence value.
-	const UINT64 fence = m_fenceValue;
+	const UINT64 fence = m_nextFenceValue;
 	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fence));
-	m_fenceValue++;
+	m_nextFenceValue++;
 
-	// Wait until the previous frame is finished.
+	// Wait until the gpu has caught up with the queue.
 	if (m_fence->GetCompletedValue() < fence)
 	{
 		ThrowIfFailed(m_fence->SetEventOnCompletion(fence, m_fenceEvent));
@@ -330,6 +368,45 @@ void HelloTriangle::WaitForPreviousFrame()
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 }
 
+// Prepare to render the next frame. Rather than waiting for the frame that was just
+// submitted, only wait for the frame that last used the next frame context, which
+// lets the cpu run up to FramesInFlight frames ahead of the gpu.
+void HelloTriangle::MoveToNextFrame()
+{
+	// Schedule a Signal command in the queue marking the end of the current frame.
+	const UINT64 fence = m_nextFenceValue;
+	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fence));
+	m_frameContexts[m_frameContextIndex].fenceValue = fence;
+	m_nextFenceValue++;
+	m_frameCount++;
+
+	// Update the frame indices.
+	m_frameContextIndex = (m_frameContextIndex + 1) % FramesInFlight;
+	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+	// Wait until the gpu is done with the frame that last used this context.
+	WaitForFenceValue(m_frameContexts[m_frameContextIndex].fenceValue);
+}
+
+// Block until the fence reaches the given value, recording how often and how long we waited.
+void HelloTriangle::WaitForFenceValue(UINT64 fenceValue)
+{
+	if (m_fence->GetCompletedValue() >= fenceValue)
+	{
+		return;
+	}
+
+	LARGE_INTEGER waitStart, waitEnd;
+	QueryPerformanceCounter(&waitStart);
+
+	ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+	WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+
+	QueryPerformanceCounter(&waitEnd);
+	m_fenceWaitCount++;
+	m_fenceWaitTicks += waitEnd.QuadPart - waitStart.QuadPart;
+}
+
 // Get the first available hardware adapter that supports Direct3D 12
 void HelloTriangle::GetHardwareAdapter(IDXGIFactory2* pFactory, IDXGIAdapter1** ppAdapter)
 {
@@ -28,6 +28,12 @@ public:
 	UINT GetWidth() const { return m_width; }
 	UINT GetHeight() const { return m_height; }
 	const WCHAR* GetTitle() const { return m_title.c_str(); }
+	bool IsOccluded(); // the last present found the window hidden, and it still is
+
+	// Frame pacing statistics
+	UINT64 GetFrameCount() const { return m_frameCount; } // number of frames submitted so far
+	UINT64 GetFenceWaitCount() const { return m_fenceWaitCount; } // number of frames where the cpu had to block on the gpu
+	double GetFenceWaitTime() const; // total time in milliseconds the cpu spent blocked on the gpu
 
 protected:
 	void GetHardwareAdapter(_In_ IDXGIFactory2* pFactory, _Outptr_result_maybenull_ IDXGIAdapter1** ppAdapter);
@@ -37,9 +43,18 @@ protected:
 	UINT m_height; // window height
 
 	wstring m_title; // window title
+	bool m_occluded; // nothing of the window was visible on the last present
 
 private:
 	static const UINT FrameCount = 3; // number of buffers we want, 2 for double buffering, 3 for tripple buffering
+	static const UINT FramesInFlight = 2; // number of frames the cpu can record ahead of the gpu before it has to wait
+
+	// everything the cpu needs to keep alive until the gpu has finished a frame
+	struct FrameContext
+	{
+		ComPtr<ID3D12CommandAllocator> commandAllocator; // allocator the frame's command list was recorded with
+		UINT64 fenceValue; // fence value signaled when the gpu has finished the frame
+	};
 
 	// vertex structure
 	struct Vertex
@@ -54,7 +69,7 @@ private:
 	ComPtr<IDXGISwapChain3> m_swapChain; // swapchain used to switch between render targets
 	ComPtr<ID3D12Device> m_device; // direct3d device
 	ComPtr<ID3D12Resource> m_renderTargets[FrameCount]; // number of render targets equal to buffer count
-	ComPtr<ID3D12CommandAllocator> m_commandAllocator; // we want enough allocators for each buffer * number of threads (we only have one thread)
+	FrameContext m_frameContexts[FramesInFlight]; // ring of frame contexts, we want enough allocators for each frame in flight * number of threads (we only have one thread)
 	ComPtr<ID3D12CommandQueue> m_commandQueue; // container for command lists
 	ComPtr<ID3D12RootSignature> m_rootSignature; // root signature defines data shaders will access
 	ComPtr<ID3D12DescriptorHeap> m_rtvDescriptorHeap; // a descriptor heap to hold resources like the render targets
@@ -69,13 +84,22 @@ private:
 
 	// Synchronization objects
 	UINT m_frameIndex; // current rtv we are on
+	UINT m_frameContextIndex; // current frame context we are recording into
 	HANDLE m_fenceEvent; // a handle to an event when our fence is unlocked by the gpu
 	ComPtr<ID3D12Fence> m_fence; // an object that is locked while our command list is being executed by the gpu. We need as many 
 							     // as we have allocators (more if we want to know when the gpu is finished with an asset)
-	UINT64 m_fenceValue; // this value is incremented each frame. each fence will have its own value
+	UINT64 m_nextFenceValue; // this value is incremented every time we signal the fence
+
+	// Frame pacing statistics
+	UINT64 m_frameCount;
+	UINT64 m_fenceWaitCount;
+	LONGLONG m_fenceWaitTicks;
+	LARGE_INTEGER m_ticksPerSecond;
 
 	void LoadPipeline();
 	void LoadResource();
 	void PopulateCommandList();
-	void WaitForPreviousFrame();
+	void MoveToNextFrame();
+	void WaitForFenceValue(UINT64 fenceValue);
+	void WaitForGPU();
 };
@@ -48,16 +48,35 @@ int Win32Application::Run(HelloTriangle* pSample, HINSTANCE hInstance, int nCmdS
 
 	ShowWindow(m_hwnd, nCmdShow);
 
-	// Main sample loop
+	// Main sample loop. Frames are rendered back to back whenever the message queue is
+	// empty, vsync in Present() paces them.
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
 	{
-		// Process any messages in the queue.
+		// Process any messages in the queue before the next frame.
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			continue;
 		}
+
+		// Frames nobody can see aren't worth rendering, so sleep until a message arrives instead.
+		// Restoring a minimized window always sends messages, but a window that is uncovered
+		// isn't told, so occlusion is checked again every OcclusionPollInterval.
+		if (IsIconic(m_hwnd))
+		{
+			MsgWaitForMultipleObjectsEx(0, nullptr, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			continue;
+		}
+		if (pSample->IsOccluded())
+		{
+			MsgWaitForMultipleObjectsEx(0, nullptr, OcclusionPollInterval, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			continue;
+		}
+
+		pSample->OnUpdate();
+		pSample->OnRender();
 	}
 
 	pSample->OnDestroy();
@@ -81,14 +100,6 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
 		}
 		return 0;
 
-	case WM_PAINT:
-		if (pSample)
-		{
-			pSample->OnUpdate();
-			pSample->OnRender();
-		}
-		return 0;
-
 	case WM_DESTROY:
 		PostQuitMessage(0);
 		return 0;
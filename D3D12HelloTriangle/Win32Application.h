@@ -25,5 +25,7 @@ protected:
 	static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
 private:
+	static const DWORD OcclusionPollInterval = 100; // milliseconds between checks whether an occluded window is visible again
+
 	static HWND m_hwnd; // window handle
 };